@@ -0,0 +1,383 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Audio - Audio device, sound effects voice pool and callback telemetry
+//
+// Every sound effect is loaded once at startup. Each mixer channel is a
+// voice; when all of them are busy the new sound can only steal the least
+// important one (lower priority first, then farther from the listener,
+// then the oldest). Identical sounds are also limited per tick, so a whole
+// asteroid wave hitting the ground at once does not flood the mixer.
+//
+// The post-mix callback arrival is checked against a grid one buffer period
+// apart, pulled to the earliest arrivals seen. SDL_mixer runs the post-mix
+// at the end of its own callback, so how late a callback ends on that grid,
+// plus the in-house mixer stage, is the load of the whole callback: SDL_mixer
+// mixing and decoding and any scheduling delay. Arriving over half a period
+// late is an underrun. The buffer size suggested for the next safe point
+// only steps down when the worst load of a whole window would still fit in
+// the smaller period with room to spare, and steps up after any underrun.
+// -------------------------------------------------------------------------
+
+#include "Audio.h"
+#include "Mixer.h"
+
+#include <stdio.h>			// Required for: printf()
+#include <stdlib.h>			// Required for: abs()
+
+struct SoundFxInfo
+{
+	const char* file;
+	int priority;			// Higher values can steal voices from lower ones
+	int max_per_tick;		// Identical sounds allowed to start in the same tick
+	int volume;				// 0..MIX_MAX_VOLUME
+};
+
+static const SoundFxInfo fx_info[FX_COUNT] =
+{
+	{ "Assets/fx_shoot.wav",     1, 1, MIX_MAX_VOLUME },		// FX_SHOOT
+	{ "Assets/fx_asteroid.wav",  0, 2, MIX_MAX_VOLUME/2 },		// FX_ASTEROID
+	{ "Assets/fx_explosion.wav", 3, 1, MIX_MAX_VOLUME },		// FX_EXPLOSION
+};
+
+struct Voice
+{
+	int fx;					// Sound effect assigned to the voice
+	int priority;
+	int x;
+	Uint32 start_tick;
+};
+
+static Mix_Chunk* chunks[FX_COUNT];
+static Voice voices[MAX_SFX_VOICES];
+static SDL_atomic_t voice_busy[MAX_SFX_VOICES];		// Cleared from the audio thread
+static int voice_count = 0;
+static bool use_mixer = false;
+
+static int plays_this_tick[FX_COUNT];
+static Uint32 current_tick = 0;
+static int listener_x = 0;
+
+static SoundFxStats stats;
+
+#define ADAPT_MIN_CALLBACKS		 200	// Clean callbacks needed before stepping the buffer down
+#define ADAPT_DOWN_LOAD			0.25	// Worst load allowed, in buffer periods, to step down
+
+static int device_frequency = 0;
+static int device_buffer = 0;			// 0 while the device is closed
+static bool mixer_requested = false;
+static bool adaptive_buffer = false;
+static int buffer_floor = MIN_AUDIO_BUFFER;		// Raised after underruns
+static int resizes = 0;
+
+static SDL_atomic_t mixer_enabled;		// Read by the audio thread
+static Uint64 callback_period = 0;		// Buffer duration in performance counter ticks
+static Uint64 next_deadline = 0;		// Audio thread only
+
+static SDL_atomic_t total_callbacks;
+static SDL_atomic_t total_underruns;
+static SDL_atomic_t last_postmix_us;
+static SDL_atomic_t max_postmix_us;
+static SDL_atomic_t max_load_us;
+static SDL_atomic_t window_callbacks;	// Measuring window for SuggestAudioBuffer()
+static SDL_atomic_t window_underruns;
+static SDL_atomic_t window_load_us;		// Worst load of the window
+
+// WARNING: Called from the audio thread (or from Mix_HaltChannel() caller)
+static void SDLCALL OnChannelFinished(int channel)
+{
+	if ((channel >= 0) && (channel < MAX_SFX_VOICES)) SDL_AtomicSet(&voice_busy[channel], 0);
+}
+
+// WARNING: Called from the audio thread, after SDL_mixer mixed music and channels
+static void SDLCALL AudioPostMix(void* udata, Uint8* stream, int len)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	if (SDL_AtomicGet(&mixer_enabled) != 0) MixerPostMix(stream, len);
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	int us = (int)((SDL_GetPerformanceCounter() - start)*1000000/frequency);
+	Uint64 late = 0;
+
+	// Arriving more than half a period after the expected time means the device ran out of data
+	// NOTE: Early arrivals move the grid earlier, bursts only make the load look higher
+	if ((next_deadline == 0) || (start <= next_deadline)) next_deadline = start + callback_period;
+	else if (start > next_deadline + callback_period/2)
+	{
+		SDL_AtomicAdd(&total_underruns, 1);
+		SDL_AtomicAdd(&window_underruns, 1);
+		next_deadline = start + callback_period;
+	}
+	else
+	{
+		late = start - next_deadline;
+		next_deadline += callback_period;
+	}
+
+	int load = (int)(late*1000000/frequency) + us;
+	if (load > SDL_AtomicGet(&window_load_us)) SDL_AtomicSet(&window_load_us, load);
+	if (load > SDL_AtomicGet(&max_load_us)) SDL_AtomicSet(&max_load_us, load);
+
+	SDL_AtomicAdd(&total_callbacks, 1);
+	SDL_AtomicAdd(&window_callbacks, 1);
+	SDL_AtomicSet(&last_postmix_us, us);
+	if (us > SDL_AtomicGet(&max_postmix_us)) SDL_AtomicSet(&max_postmix_us, us);
+}
+
+static int VoiceScore(int priority, int x)
+{
+	return priority*SFX_PRIORITY_WEIGHT - abs(x - listener_x);
+}
+
+// ----------------------------------------------------------------
+static void InitSoundFx(bool custom_mixer)
+{
+	voice_count = Mix_AllocateChannels(MAX_SFX_VOICES);
+	if (voice_count > MAX_SFX_VOICES) voice_count = MAX_SFX_VOICES;
+
+	for (int i = 0; i < MAX_SFX_VOICES; ++i)
+	{
+		voices[i].fx = -1;
+		SDL_AtomicSet(&voice_busy[i], 0);
+	}
+
+	use_mixer = custom_mixer && InitMixer();
+	if (use_mixer) MixerVoiceFinished(OnChannelFinished);
+	else Mix_ChannelFinished(OnChannelFinished);
+	SDL_AtomicSet(&mixer_enabled, use_mixer? 1 : 0);
+
+	// L4: DONE EXTRA: Handle the case the sound can not be loaded!
+	for (int i = 0; i < FX_COUNT; ++i)
+	{
+		chunks[i] = Mix_LoadWAV(fx_info[i].file);
+
+		if (chunks[i] == NULL) printf("WARNING: Unable to load sound %s! Mix_Error: %s\n", fx_info[i].file, Mix_GetError());
+		else Mix_VolumeChunk(chunks[i], fx_info[i].volume);
+	}
+}
+
+// ----------------------------------------------------------------
+static void FreeSoundFx()
+{
+	if (use_mixer)
+	{
+		// NOTE: Mix_SetPostMix() locks the device, no callback is mixing voices after it
+		SDL_AtomicSet(&mixer_enabled, 0);
+		Mix_SetPostMix(AudioPostMix, NULL);
+		CloseMixer();
+	}
+
+	Mix_HaltChannel(-1);
+	Mix_ChannelFinished(NULL);
+	use_mixer = false;
+
+	for (int i = 0; i < FX_COUNT; ++i)
+	{
+		if (chunks[i] != NULL) Mix_FreeChunk(chunks[i]);
+		chunks[i] = NULL;
+	}
+
+	voice_count = 0;
+}
+
+// ----------------------------------------------------------------
+static bool OpenDevice(int frequency, int buffer)
+{
+	if (Mix_OpenAudio(frequency, MIX_DEFAULT_FORMAT, 2, buffer) != 0)
+	{
+		printf("WARNING: Unable to open audio device! Mix_Error: %s\n", Mix_GetError());
+		return false;
+	}
+
+	// NOTE: Device may run at a different frequency than requested
+	Mix_QuerySpec(&device_frequency, NULL, NULL);
+	device_buffer = buffer;
+	callback_period = (Uint64)buffer*SDL_GetPerformanceFrequency()/device_frequency;
+	next_deadline = 0;
+
+	SDL_AtomicSet(&window_callbacks, 0);
+	SDL_AtomicSet(&window_underruns, 0);
+	SDL_AtomicSet(&window_load_us, 0);
+
+	InitSoundFx(mixer_requested);
+	Mix_SetPostMix(AudioPostMix, NULL);
+
+	return true;
+}
+
+static void CloseDevice()
+{
+	FreeSoundFx();
+	Mix_SetPostMix(NULL, NULL);
+	Mix_CloseAudio();
+
+	device_buffer = 0;
+}
+
+// ----------------------------------------------------------------
+bool OpenAudio(int frequency, int buffer, bool custom_mixer, bool adaptive)
+{
+	mixer_requested = custom_mixer;
+	adaptive_buffer = adaptive;
+	buffer_floor = MIN_AUDIO_BUFFER;
+	resizes = 0;
+
+	SDL_zero(stats);
+	SDL_AtomicSet(&total_callbacks, 0);
+	SDL_AtomicSet(&total_underruns, 0);
+	SDL_AtomicSet(&last_postmix_us, 0);
+	SDL_AtomicSet(&max_postmix_us, 0);
+	SDL_AtomicSet(&max_load_us, 0);
+
+	return OpenDevice(frequency, buffer);
+}
+
+// ----------------------------------------------------------------
+void CloseAudio()
+{
+	if (device_buffer != 0) CloseDevice();
+}
+
+// ----------------------------------------------------------------
+int SuggestAudioBuffer()
+{
+	int callbacks = SDL_AtomicSet(&window_callbacks, 0);
+	int underruns = SDL_AtomicSet(&window_underruns, 0);
+	int load_us = SDL_AtomicSet(&window_load_us, 0);
+
+	if (!adaptive_buffer || (device_buffer == 0)) return 0;
+
+	// Any underrun: go back up and never try the failing size again
+	if (underruns > 0)
+	{
+		if (device_buffer >= MAX_AUDIO_BUFFER) return 0;
+
+		buffer_floor = device_buffer*2;
+		return device_buffer*2;
+	}
+
+	// Step down after a long enough window whose worst callback would still leave most of the smaller period free
+	int smaller = device_buffer/2;
+	double period_us = device_buffer*1000000.0/device_frequency;
+
+	if ((callbacks >= ADAPT_MIN_CALLBACKS) && (load_us < period_us*ADAPT_DOWN_LOAD) && (smaller >= buffer_floor)) return smaller;
+
+	return 0;
+}
+
+// ----------------------------------------------------------------
+bool ResizeAudioBuffer(int buffer)
+{
+	int frequency = device_frequency;
+
+	if (device_buffer != 0) CloseDevice();
+	if (!OpenDevice(frequency, buffer)) return false;
+
+	resizes++;
+	printf("Audio buffer set to %i samples (%.1f ms)\n", buffer, buffer*1000.0f/device_frequency);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+AudioStats GetAudioStats()
+{
+	AudioStats audio;
+
+	audio.frequency = device_frequency;
+	audio.buffer = device_buffer;
+	audio.callbacks = SDL_AtomicGet(&total_callbacks);
+	audio.underruns = SDL_AtomicGet(&total_underruns);
+	audio.resizes = resizes;
+	audio.last_postmix_ms = SDL_AtomicGet(&last_postmix_us)/1000.0f;
+	audio.max_postmix_ms = SDL_AtomicGet(&max_postmix_us)/1000.0f;
+	audio.max_load_ms = SDL_AtomicGet(&max_load_us)/1000.0f;
+
+	return audio;
+}
+
+// ----------------------------------------------------------------
+void BeginSoundFxTick(int x)
+{
+	current_tick++;
+	listener_x = x;
+	for (int i = 0; i < FX_COUNT; ++i) plays_this_tick[i] = 0;
+}
+
+// ----------------------------------------------------------------
+bool PlaySoundFx(SoundFx fx, int x)
+{
+	if (chunks[fx] == NULL) return false;
+
+	if (plays_this_tick[fx] >= fx_info[fx].max_per_tick)
+	{
+		stats.rate_limited++;
+		return false;
+	}
+
+	// Look for a free voice, remembering the least important busy one
+	int voice = -1;
+	int victim = -1;
+	int victim_score = 0;
+
+	for (int i = 0; i < voice_count; ++i)
+	{
+		if (SDL_AtomicGet(&voice_busy[i]) == 0) { voice = i; break; }
+
+		int score = VoiceScore(voices[i].priority, voices[i].x);
+
+		if ((victim == -1) || (score < victim_score) ||
+			((score == victim_score) && (voices[i].start_tick < voices[victim].start_tick)))
+		{
+			victim = i;
+			victim_score = score;
+		}
+	}
+
+	if (voice == -1)
+	{
+		// Only steal when the new sound is at least as important as the victim
+		if ((victim == -1) || (VoiceScore(fx_info[fx].priority, x) < victim_score))
+		{
+			stats.rejected++;
+			return false;
+		}
+
+		// NOTE: The in-house mixer fades the victim out by itself
+		if (!use_mixer) Mix_HaltChannel(victim);
+		voice = victim;
+		stats.stolen++;
+	}
+	else stats.played++;
+
+	voices[voice].fx = fx;
+	voices[voice].priority = fx_info[fx].priority;
+	voices[voice].x = x;
+	voices[voice].start_tick = current_tick;
+	SDL_AtomicSet(&voice_busy[voice], 1);
+
+	if (use_mixer)
+	{
+		if (!MixerPlay(voice, chunks[fx], (float)fx_info[fx].volume/MIX_MAX_VOLUME))
+		{
+			SDL_AtomicSet(&voice_busy[voice], 0);
+			return false;
+		}
+	}
+	else if (Mix_PlayChannel(voice, chunks[fx], 0) == -1)
+	{
+		SDL_AtomicSet(&voice_busy[voice], 0);
+		printf("WARNING: Unable to play sound %s! Mix_Error: %s\n", fx_info[fx].file, Mix_GetError());
+		return false;
+	}
+
+	plays_this_tick[fx]++;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+SoundFxStats GetSoundFxStats()
+{
+	return stats;
+}
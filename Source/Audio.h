@@ -0,0 +1,78 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Audio - Audio device, sound effects voice pool and callback telemetry
+//
+// SDL_mixer API: https://www.libsdl.org/projects/SDL_mixer/docs/SDL_mixer.html
+// -------------------------------------------------------------------------
+
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include "SDL/include/SDL.h"				// Required for SDL base systems functionality
+#include "SDL_mixer/include/SDL_mixer.h"	// Required for audio loading and playing functionality
+
+#define MAX_SFX_VOICES		  16		// Channels requested with Mix_AllocateChannels()
+#define SFX_PRIORITY_WEIGHT	1024		// Bigger than any distance, so priority always wins
+
+#define MIN_AUDIO_BUFFER	 256		// Adaptive buffer limits, in sample frames
+#define MAX_AUDIO_BUFFER	4096
+
+enum SoundFx
+{
+	FX_SHOOT = 0,
+	FX_ASTEROID,
+	FX_EXPLOSION,
+	FX_COUNT
+};
+
+struct SoundFxStats
+{
+	int played;			// Sounds started on a free voice
+	int stolen;			// Sounds started by halting a less important voice
+	int rate_limited;	// Dropped because too many identical sounds in the same tick
+	int rejected;		// Dropped because every voice was more important
+};
+
+struct AudioStats
+{
+	int frequency;
+	int buffer;				// Current callback size in sample frames
+	int callbacks;
+	int underruns;			// Callbacks arriving much later than the buffer period
+	int resizes;
+	float last_postmix_ms;	// In-house mixer post-mix stage only, SDL_mixer's own mixing is not timed
+	float max_postmix_ms;
+	float max_load_ms;		// Whole callback: its end past the expected time, plus the post-mix stage
+};
+
+// Open the audio device, load all sound effects and setup the voice pool
+// custom_mixer plays the voices through the in-house mixer (see Mixer.h)
+// instead of SDL_mixer channels, falling back if it can not be used
+// adaptive lets SuggestAudioBuffer() move the buffer size from the initial one
+bool OpenAudio(int frequency, int buffer, bool custom_mixer, bool adaptive);
+void CloseAudio();
+
+// Buffer size the device should switch to, 0 to keep the current one
+// A window without underruns whose worst callback load stays under a quarter
+// of a buffer period steps the size down, any underrun steps it back up
+// NOTE: Every call starts a new measuring window
+int SuggestAudioBuffer();
+
+// Reopen the device with a new buffer size, sound effects are reloaded
+// WARNING: Only call it at a safe point of the main thread, all Mix_Music must be freed
+// before and loaded again after, SDL_mixer unloads its decoders on close
+bool ResizeAudioBuffer(int buffer);
+
+AudioStats GetAudioStats();
+
+// Call once per simulation tick, before any PlaySoundFx()
+// listener_x is used to rank voices by distance (usually the ship position)
+void BeginSoundFxTick(int listener_x);
+
+// Play a sound effect originated at horizontal position x,
+// returns false if the sound has been dropped
+bool PlaySoundFx(SoundFx fx, int x);
+
+SoundFxStats GetSoundFxStats();
+
+#endif // __AUDIO_H__
@@ -0,0 +1,271 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Batch - Headless games played by bots, as many as the cores allow
+// -------------------------------------------------------------------------
+
+#include "Batch.h"
+#include "Lanes.h"
+#include "Jobs.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+// One game result, only the job playing it writes it
+struct alignas(SDL_CACHELINE_SIZE) BatchGame
+{
+	int rounds;
+	int survived;
+	int desyncs;
+	Uint64 round_ticks;
+	int best_round_ticks;
+	int wins[MAX_PLAYERS];
+	int mistakes;
+};
+
+struct BatchRun
+{
+	const BatchConfig* config;
+	BatchGame* games;
+	int* histograms;				// Rounds lost per second survived, up to the game length, one histogram per job chunk
+	int buckets;
+};
+
+// Histogram of the job chunk playing game g, chunks start every BATCH_JOB_GAMES games however ParallelFor() splits them
+static int* ChunkHistogram(const BatchRun* run, int g)
+{
+	return &run->histograms[(g/BATCH_JOB_GAMES)*run->buckets];
+}
+
+// Round bookkeeping after a tick moved the game from screen
+static void TrackRound(const BatchConfig* config, Uint8 screen, const SimState* sim, Uint32* round_start, BatchGame* result, int* histogram)
+{
+	if (sim->screen == screen) return;
+
+	if (sim->screen == GAMEPLAY) *round_start = sim->tick;
+	else if ((screen == GAMEPLAY) && (sim->screen == ENDING))
+	{
+		int ticks = (int)(sim->tick - *round_start);
+
+		result->rounds++;
+		result->round_ticks += ticks;
+		histogram[ticks/SIM_TICK_RATE]++;
+		if (ticks > result->best_round_ticks) result->best_round_ticks = ticks;
+
+		if (config->players > 1) for (int s = 0; s < config->players; ++s) if (sim->ships_alive & (1u << s)) result->wins[s]++;
+	}
+}
+
+static void StartGame(const BatchConfig* config, Uint32 seed, SimState* sim, Bot* bots)
+{
+	InitSim(sim, seed, config->players);
+	for (int s = 0; s < config->players; ++s) ResetBot(&bots[s], s, config->skills[s], seed*2654435761u + s);
+}
+
+// Actions of every bot of the game, shifted to their ship bits
+static Uint32 StepBots(const BatchConfig* config, Bot* bots, const SimState* sim)
+{
+	Uint32 actions = 0;
+
+	for (int s = 0; s < config->players; ++s)
+	{
+		if (config->skills[s] != BOT_OFF) actions |= StepBot(&bots[s], sim) << (s*PLAYER_ACTION_BITS);
+	}
+
+	return actions;
+}
+
+static void EndGame(const BatchConfig* config, const SimState* sim, const Bot* bots, BatchGame* result)
+{
+	if (sim->screen == GAMEPLAY) result->survived++;
+	for (int s = 0; s < config->players; ++s) if (config->skills[s] != BOT_OFF) result->mistakes += GetBotStats(&bots[s]).mistakes;
+}
+
+static void PlayGame(const BatchConfig* config, Uint32 seed, BatchGame* result, int* histogram)
+{
+	SimState sim;
+	Bot bots[MAX_PLAYERS];
+	Uint32 round_start = 0;
+
+	StartGame(config, seed, &sim, bots);
+
+	for (int t = 0; t < config->ticks; ++t)
+	{
+		Uint8 screen = sim.screen;
+
+		MoveStuff(&sim, StepBots(config, bots, &sim), NULL);
+		TrackRound(config, screen, &sim, &round_start, result, histogram);
+	}
+
+	EndGame(config, &sim, bots, result);
+}
+
+// Games [first, first + count) one per lane, spare lanes play games nobody counts
+// With config->check every game is also stepped alone, lanes must hash the same every tick
+static void PlayLaneGames(const BatchConfig* config, int first, int count, BatchGame* results, int* histogram)
+{
+	SimLanes lanes;
+	SimState sims[SIM_LANES];
+	SimState alone[SIM_LANES];
+	Bot bots[SIM_LANES][MAX_PLAYERS];
+	Uint32 round_start[SIM_LANES] = { 0 };
+	Uint32 actions[SIM_LANES];
+	bool desynced[SIM_LANES] = { false };
+
+	for (int lane = 0; lane < SIM_LANES; ++lane)
+	{
+		StartGame(config, config->seed + first + lane, &sims[lane], bots[lane]);
+		SetSimLane(&lanes, lane, &sims[lane]);
+		alone[lane] = sims[lane];
+	}
+
+	for (int t = 0; t < config->ticks; ++t)
+	{
+		Uint8 screens[SIM_LANES];
+
+		for (int lane = 0; lane < SIM_LANES; ++lane)
+		{
+			screens[lane] = sims[lane].screen;
+			actions[lane] = StepBots(config, bots[lane], &sims[lane]);
+		}
+
+		MoveStuffLanes(&lanes, actions);
+		UnpackSimLanes(&lanes, sims);
+
+		for (int lane = 0; lane < count; ++lane)
+		{
+			TrackRound(config, screens[lane], &sims[lane], &round_start[lane], &results[lane], histogram);
+
+			if (!config->check || desynced[lane]) continue;
+
+			MoveStuff(&alone[lane], actions[lane], NULL);
+
+			if (HashSim(&sims[lane]) != HashSim(&alone[lane]))
+			{
+				printf("WARNING: Batch game %i desync at tick %u, lanes against the scalar step:\n", first + lane, alone[lane].tick - 1);
+				PrintSimDiff(&sims[lane], &alone[lane]);
+				desynced[lane] = true;
+				results[lane].desyncs++;
+			}
+		}
+	}
+
+	for (int lane = 0; lane < count; ++lane) EndGame(config, &sims[lane], bots[lane], &results[lane]);
+}
+
+// Job body: games [begin, end), each one on its own or SIM_LANES at once, nested parallel loops run inline
+static void PlayGames(int begin, int end, void* data)
+{
+	BatchRun* run = (BatchRun*)data;
+	const BatchConfig* config = run->config;
+
+	SetSerialJobs(true);
+
+	if (config->lanes)
+	{
+		for (int g = begin; g < end; g += SIM_LANES) PlayLaneGames(config, g, SDL_min(SIM_LANES, end - g), &run->games[g], ChunkHistogram(run, g));
+	}
+	else for (int g = begin; g < end; ++g) PlayGame(config, config->seed + g, &run->games[g], ChunkHistogram(run, g));
+
+	SetSerialJobs(false);
+}
+
+// Ticks of the round at fraction of the rounds, at the end of its histogram bucket
+static int RoundPercentile(const int* histogram, int buckets, int rounds, float fraction)
+{
+	if (rounds == 0) return 0;
+
+	int wanted = (int)(rounds*fraction);
+	int seen = 0;
+
+	for (int b = 0; b < buckets; ++b)
+	{
+		seen += histogram[b];
+		if (seen > wanted) return (b + 1)*SIM_TICK_RATE;
+	}
+
+	return buckets*SIM_TICK_RATE;
+}
+
+// ----------------------------------------------------------------
+BatchStats RunBatch(const BatchConfig* config)
+{
+	BatchStats stats;
+	SDL_zero(stats);
+
+	if (config->games <= 0) return stats;
+
+	BatchRun run;
+	run.config = config;
+	run.games = (BatchGame*)SDL_calloc(config->games, sizeof(BatchGame));
+
+	// Rounds never outlast their game, one bucket per second of it
+	// NOTE: The extra histogram gets the sum of the chunk ones
+	int chunks = (config->games + BATCH_JOB_GAMES - 1)/BATCH_JOB_GAMES;
+	run.buckets = config->ticks/SIM_TICK_RATE + 1;
+	run.histograms = (int*)SDL_calloc((chunks + 1)*run.buckets, sizeof(int));
+
+	if ((run.games == NULL) || (run.histograms == NULL))
+	{
+		printf("WARNING: Cannot allocate %i batch games\n", config->games);
+		SDL_free(run.games);
+		SDL_free(run.histograms);
+		return stats;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	ParallelFor(config->games, BATCH_JOB_GAMES, PlayGames, &run);
+	stats.seconds = (double)(SDL_GetPerformanceCounter() - start)/SDL_GetPerformanceFrequency();
+
+	// Reduce in game order, then the histograms in chunk order
+	Uint64 round_ticks = 0;
+	int* histogram = &run.histograms[chunks*run.buckets];
+
+	for (int g = 0; g < config->games; ++g)
+	{
+		const BatchGame* game = &run.games[g];
+
+		stats.rounds += game->rounds;
+		stats.survived += game->survived;
+		stats.desyncs += game->desyncs;
+		stats.mistakes += game->mistakes;
+		round_ticks += game->round_ticks;
+		if (game->best_round_ticks > stats.best_round_ticks) stats.best_round_ticks = game->best_round_ticks;
+		for (int s = 0; s < MAX_PLAYERS; ++s) stats.wins[s] += game->wins[s];
+	}
+
+	for (int c = 0; c < chunks; ++c)
+	{
+		for (int b = 0; b < run.buckets; ++b) histogram[b] += run.histograms[c*run.buckets + b];
+	}
+
+	SDL_free(run.games);
+
+	stats.games = config->games;
+	stats.kernel = config->lanes? GetLanesKernel() : "scalar";
+	stats.ticks = (Uint64)config->games*config->ticks;
+	stats.avg_round_ticks = (stats.rounds > 0)? (float)round_ticks/stats.rounds : 0.0f;
+	stats.median_round_ticks = RoundPercentile(histogram, run.buckets, stats.rounds, 0.5f);
+	stats.p90_round_ticks = RoundPercentile(histogram, run.buckets, stats.rounds, 0.9f);
+	SDL_free(run.histograms);
+	stats.cores = SDL_min(GetJobStats().workers + 1, SDL_GetCPUCount());
+	stats.games_per_second = (stats.seconds > 0.0)? (float)(stats.games/stats.seconds) : 0.0f;
+	stats.games_per_second_per_core = stats.games_per_second/stats.cores;
+
+	return stats;
+}
+
+// ----------------------------------------------------------------
+void PrintBatchStats(const char* label, const BatchStats* stats)
+{
+	printf("Batch %s: %i games, %i rounds lost, %i survived to the end, survival avg %.1f s, median %i s, p90 %i s, best %.1f s, %i mistakes",
+		label, stats->games, stats->rounds, stats->survived, stats->avg_round_ticks/SIM_TICK_RATE, stats->median_round_ticks/SIM_TICK_RATE,
+		stats->p90_round_ticks/SIM_TICK_RATE, (float)stats->best_round_ticks/SIM_TICK_RATE, stats->mistakes);
+
+	if (stats->wins[0] + stats->wins[1] > 0) printf(", wins %i-%i", stats->wins[0], stats->wins[1]);
+
+	if (stats->desyncs > 0) printf(", %i lane games desynced", stats->desyncs);
+
+	printf("\n  %s step, %.2f s, %.0f games/s on %i cores, %.0f games/s per core, %.1f M ticks/s\n",
+		stats->kernel, stats->seconds, stats->games_per_second, stats->cores, stats->games_per_second_per_core,
+		(stats->seconds > 0.0)? stats->ticks/stats->seconds/1000000.0 : 0.0);
+}
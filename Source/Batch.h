@@ -0,0 +1,63 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Batch - Headless games played by bots, as many as the cores allow
+//
+// Every game owns its SimState and its bots, seeded from the batch seed
+// and its index, and writes its result to its own slot, and its rounds
+// to the histogram of its job chunk: games share nothing, jobs run them on
+// every worker and results are reduced in game order afterwards, so a
+// batch gives the same numbers on any core count.
+// By default games are stepped SIM_LANES at once (see Lanes.h), a job
+// plays them in lockstep and only the bots decide game by game.
+// -------------------------------------------------------------------------
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+#include "Bot.h"
+#include "Lanes.h"
+
+#define BATCH_GAME_TICKS	(5*60*SIM_TICK_RATE)	// Game length by default, 5 minutes
+#define BATCH_JOB_GAMES		(2*SIM_LANES)	// Games per job
+
+struct BatchConfig
+{
+	int games;
+	int ticks;						// Per game
+	int players;					// 2 for versus games
+	BotSkill skills[MAX_PLAYERS];	// Bot of each ship
+	Uint32 seed;					// Game g plays seed + g
+	bool lanes;						// Step SIM_LANES games at once, else one by one
+	bool check;						// Step lane games alone too, comparing hashes every tick
+};
+
+struct BatchStats
+{
+	int games;
+	Uint64 ticks;					// Simulated, every game included
+	int rounds;						// Lost, the statistics below are about them
+	int survived;					// Rounds still going when their game ended
+	float avg_round_ticks;
+	int median_round_ticks;			// One second resolution, the histogram spans the whole game
+	int p90_round_ticks;
+	int best_round_ticks;
+	int wins[MAX_PLAYERS];			// Versus rounds each ship survived
+	int mistakes;
+	int desyncs;					// Lane games hashing differently from the same game stepped alone
+	const char* kernel;				// Step used, see GetLanesKernel()
+	double seconds;
+	int cores;						// Threads playing games (job workers and the calling thread), at most the CPU count
+	float games_per_second;
+	float games_per_second_per_core;
+};
+
+// Play config->games games on the job workers and wait for all of them
+BatchStats RunBatch(const BatchConfig* config);
+
+// Print a one line summary, label names the batch
+void PrintBatchStats(const char* label, const BatchStats* stats);
+
+#endif // __BATCH_H__
@@ -0,0 +1,224 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Bot - Scripted players for soak tests, profiling and difficulty tuning
+// -------------------------------------------------------------------------
+
+#include "Bot.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#define BOT_ACTIONS			(ACTION_BIT(ACTION_MOVE_LEFT) | ACTION_BIT(ACTION_MOVE_RIGHT) | ACTION_BIT(ACTION_CONFIRM))
+#define NO_SCREEN			0xFF
+#define NO_TARGET			(-1)
+
+struct BotSkillParams
+{
+	const char* name;
+	int reaction;			// Ticks between seeing something and pressing a key
+	int sight;				// Pixels above the ship where waves are noticed
+	int mistakes;			// Percent of waves aimed at a wrong lane
+	int dead_zone;			// Pixels off the lane center considered there
+};
+
+// Indexed by BotSkill
+static const BotSkillParams skills[BOT_SKILL_COUNT] =
+{
+	{ "off", 0, 0, 0, 0 },
+	{ "novice", 18, 350, 12, 12 },
+	{ "average", 9, 600, 4, 8 },
+	{ "expert", 3, 900, 0, 4 }
+};
+
+// Bots pressing keys, see InitBot()
+static Bot bots[MAX_PLAYERS];
+static int keys[MAX_PLAYERS];			// Player whose keys each bot presses
+static Uint32 held[MAX_PLAYERS];		// Actions pressed now
+
+// Rounds end leaving gameplay, the bot won if its ship is the one left
+static void TrackScreen(Bot* bot, const SimState* sim)
+{
+	if (sim->screen == bot->screen) return;
+
+	if (sim->screen == GAMEPLAY) bot->round_start = sim->tick;
+	else if ((bot->screen == GAMEPLAY) && (sim->screen == ENDING))
+	{
+		int ticks = (int)(sim->tick - bot->round_start);
+
+		bot->stats.rounds++;
+		bot->round_ticks += ticks;
+		if (ticks > bot->stats.best_round_ticks) bot->stats.best_round_ticks = ticks;
+		if ((sim->players > 1) && (sim->ships_alive & (1u << bot->ship))) bot->stats.wins++;
+	}
+
+	bot->screen = sim->screen;
+	bot->screen_ticks = 0;
+	bot->target_shot = NO_TARGET;
+}
+
+// Lane of the next wave to pass the ship: the free one closest to it, or a wrong one now and then
+static void AimAtWave(Bot* bot, const SimState* sim)
+{
+	const BotSkillParams* params = &skills[bot->skill];
+	int ship_y = sim->ship_y;
+	int wave_y = 0;
+	int lowest = NO_TARGET;
+
+	// Waves spawn whole, their asteroids share the same height
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((sim->alive & (1u << i)) == 0) continue;
+		if ((sim->shot_y[i] >= ship_y + SHIP_SIZE) || (sim->shot_y[i] < ship_y - params->sight)) continue;
+
+		if ((lowest == NO_TARGET) || (sim->shot_y[i] > wave_y))
+		{
+			lowest = i;
+			wave_y = sim->shot_y[i];
+		}
+	}
+
+	// Nothing in sight, or the same wave as before: same slot, still falling
+	if (lowest == NO_TARGET) return;
+	if ((lowest == bot->target_shot) && (wave_y >= bot->target_y))
+	{
+		bot->target_y = wave_y;
+		return;
+	}
+
+	Uint32 taken = 0;
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((sim->alive & (1u << i)) && (sim->shot_y[i] == wave_y)) taken |= 1u << ((sim->shot_x[i] - WAVE_FIRST_LANE_X)/WAVE_LANE_WIDTH);
+	}
+
+	int ship_lane = (sim->ship_x[bot->ship] + SHIP_SIZE/2 - WAVE_FIRST_LANE_X + WAVE_LANE_WIDTH/2)/WAVE_LANE_WIDTH;
+	int lane = NO_TARGET;
+
+	for (int l = 0; l < WAVE_LANES; ++l)
+	{
+		if (taken & (1u << l)) continue;
+		if ((lane == NO_TARGET) || (SDL_abs(l - ship_lane) < SDL_abs(lane - ship_lane))) lane = l;
+	}
+
+	if ((int)(NextRandom(&bot->rng)%100) < params->mistakes)
+	{
+		lane = (int)(NextRandom(&bot->rng)%WAVE_LANES);
+		bot->stats.mistakes++;
+	}
+
+	bot->target_shot = lowest;
+	bot->target_y = wave_y;
+	if (lane != NO_TARGET) bot->target_lane = lane;
+}
+
+// Actions wanted this tick, as player 1 ones
+static Uint8 Decide(Bot* bot, const SimState* sim)
+{
+	TrackScreen(bot, sim);
+	bot->screen_ticks++;
+
+	// Title and ending: confirm now and then, releasing it in between
+	if (sim->screen != GAMEPLAY) return (bot->screen_ticks%BOT_CONFIRM_TICKS == 0)? ACTION_BIT(ACTION_CONFIRM) : 0;
+
+	if ((sim->ships_alive & (1u << bot->ship)) == 0) return 0;
+
+	AimAtWave(bot, sim);
+
+	// Ship centered on the lane, as far as the ship moves
+	int target_x = WAVE_FIRST_LANE_X + bot->target_lane*WAVE_LANE_WIDTH - SHIP_SIZE/2;
+	target_x = SDL_max(SHIP_MIN_X, SDL_min(target_x, SHIP_MAX_X));
+
+	int ship_x = sim->ship_x[bot->ship];
+	int dead_zone = skills[bot->skill].dead_zone;
+
+	if (ship_x < target_x - dead_zone) return ACTION_BIT(ACTION_MOVE_RIGHT);
+	if (ship_x > target_x + dead_zone) return ACTION_BIT(ACTION_MOVE_LEFT);
+
+	return 0;
+}
+
+// ----------------------------------------------------------------
+BotSkill GetBotSkill(const char* name)
+{
+	for (int s = BOT_NOVICE; s < BOT_SKILL_COUNT; ++s) if (SDL_strcmp(name, skills[s].name) == 0) return (BotSkill)s;
+
+	printf("WARNING: Unknown bot skill %s, expected novice, average or expert\n", name);
+
+	return BOT_OFF;
+}
+
+// ----------------------------------------------------------------
+const char* GetBotSkillName(BotSkill skill)
+{
+	return skills[skill].name;
+}
+
+// ----------------------------------------------------------------
+void ResetBot(Bot* bot, int ship, BotSkill skill, Uint32 seed)
+{
+	SDL_zerop(bot);
+	bot->skill = skill;
+	bot->ship = ship;
+	bot->rng = (seed != 0)? seed : 1;
+	bot->screen = NO_SCREEN;
+	bot->target_shot = NO_TARGET;
+	bot->target_lane = WAVE_LANES/2;
+}
+
+// ----------------------------------------------------------------
+Uint32 StepBot(Bot* bot, const SimState* sim)
+{
+	int reaction = skills[bot->skill].reaction;
+
+	bot->decisions[bot->ticks%BOT_MAX_REACTION] = Decide(bot, sim);
+	Uint32 wanted = (bot->ticks >= (Uint32)reaction)? bot->decisions[(bot->ticks - reaction)%BOT_MAX_REACTION] : 0;
+	bot->ticks++;
+
+	return wanted;
+}
+
+// ----------------------------------------------------------------
+void InitBot(int ship, int keys_player, BotSkill skill, Uint32 seed)
+{
+	ResetBot(&bots[ship], ship, skill, seed);
+	keys[ship] = keys_player;
+	held[ship] = 0;
+}
+
+// ----------------------------------------------------------------
+void UpdateBots(const SimState* sim, Uint64 time)
+{
+	for (int b = 0; b < MAX_PLAYERS; ++b)
+	{
+		if (bots[b].skill == BOT_OFF) continue;
+
+		Uint32 wanted = StepBot(&bots[b], sim);
+
+		// Only edges travel, like keys
+		Uint32 changed = (wanted ^ held[b]) & BOT_ACTIONS;
+
+		for (int a = 0; a < PLAYER_ACTION_BITS; ++a)
+		{
+			if ((changed & ACTION_BIT(a)) == 0) continue;
+
+			InjectKey(GetActionKey((Action)(a + keys[b]*PLAYER_ACTION_BITS)), (wanted & ACTION_BIT(a)) != 0, time);
+		}
+
+		held[b] = wanted;
+	}
+}
+
+// ----------------------------------------------------------------
+BotStats GetBotStats(const Bot* bot)
+{
+	BotStats stats = bot->stats;
+	stats.avg_round_ticks = (stats.rounds > 0)? (float)bot->round_ticks/stats.rounds : 0.0f;
+
+	return stats;
+}
+
+// ----------------------------------------------------------------
+BotStats GetBotStats(int ship)
+{
+	return GetBotStats(&bots[ship]);
+}
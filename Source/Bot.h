@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Bot - Scripted players for soak tests, profiling and difficulty tuning
+//
+// A bot looks at the state before every tick, picks the free lane of the
+// next asteroid wave and presses the keys to get there, through the same
+// timestamped input queue the keyboard feeds (see InjectKey()). On title
+// and ending screens it presses confirm, so sessions go on unattended.
+//
+// Skill sets how late the bot reacts, how far it sees, how often it picks
+// a wrong lane and how precisely it stops. Decisions only depend on the
+// state and the seed, so a bot session replays the same on every run.
+// -------------------------------------------------------------------------
+
+#ifndef __BOT_H__
+#define __BOT_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+
+#define BOT_MAX_REACTION		  32		// Ticks, decisions wait in a ring this size
+#define BOT_CONFIRM_TICKS		  60		// Ticks on title and ending screens before confirming
+
+enum BotSkill
+{
+	BOT_OFF = 0,
+	BOT_NOVICE,
+	BOT_AVERAGE,
+	BOT_EXPERT,
+	BOT_SKILL_COUNT
+};
+
+struct BotStats
+{
+	int rounds;					// Rounds finished
+	int wins;					// Versus rounds the other ship lost
+	int mistakes;				// Wrong lanes picked on purpose
+	float avg_round_ticks;		// Ticks survived
+	int best_round_ticks;
+};
+
+// Bot state, owned by whoever steps it: several can play separate games at once
+struct Bot
+{
+	BotSkill skill;
+	int ship;
+	Uint32 rng;
+
+	Uint32 ticks;						// Ticks seen, decisions are indexed by it
+	Uint8 decisions[BOT_MAX_REACTION];	// Actions wanted, pressed reaction ticks later
+
+	Uint8 screen;						// Screen seen last tick
+	Uint32 screen_ticks;
+	int target_shot;					// Lowest asteroid of the wave aimed at
+	int target_y;						// Its height last tick, slots are reused by new waves
+	int target_lane;
+	Uint32 round_start;
+
+	BotStats stats;
+	Uint64 round_ticks;
+};
+
+// Skill by name (novice, average, expert), BOT_OFF if unknown
+BotSkill GetBotSkill(const char* name);
+const char* GetBotSkillName(BotSkill skill);
+
+// Play ship, decisions seeded by seed
+void ResetBot(Bot* bot, int ship, BotSkill skill, Uint32 seed);
+
+// Decide from the state before a tick, returns the actions held this tick as player 1 ones
+// NOTE: Shift them by ship*PLAYER_ACTION_BITS to step the simulation directly
+Uint32 StepBot(Bot* bot, const SimState* sim);
+
+BotStats GetBotStats(const Bot* bot);
+
+// Play ship with the keys of player keys_player, decisions seeded by seed
+// NOTE: In netplay the local ship may be player 2 while the keys are player 1 ones
+void InitBot(int ship, int keys_player, BotSkill skill, Uint32 seed);
+
+// Simulation thread, before UpdateInputTick(time): decide from the state before the tick and press or release keys
+void UpdateBots(const SimState* sim, Uint64 time);
+
+// Stats of the bot InitBot() set up for ship
+BotStats GetBotStats(int ship);
+
+#endif // __BOT_H__
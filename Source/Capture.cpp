@@ -0,0 +1,343 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Capture - Gameplay video recorded from the presented frames
+// -------------------------------------------------------------------------
+
+#include "Capture.h"
+#include "Queue.h"
+#include "Game.h"
+
+#include "SDL_image/include/SDL_image.h"	// Required for: IMG_SavePNG()
+
+#include <stdio.h>			// Required for: printf()
+
+struct CaptureWriter
+{
+	char path[CAPTURE_PATH_SIZE];
+	bool png;					// PNG sequence in the path folder, Y4M video otherwise
+	SDL_RWops* video;
+	Uint8* planes;				// Y, U and V of the frame being written
+
+	int written;
+	Uint64 write_time;
+};
+
+static Uint32* buffers[CAPTURE_BUFFERS];
+static SpscQueue<int, 2*CAPTURE_BUFFERS> filled;		// Read back, main thread to writer
+static SpscQueue<int, 2*CAPTURE_BUFFERS> free_buffers;	// Written, writer to main thread
+static int held = -1;			// Popped by the main thread, readback failed
+
+static SDL_Thread* thread = NULL;
+static SDL_sem* wake = NULL;	// Posted once per frame filled
+static SDL_atomic_t running;
+
+static CaptureWriter writer;
+static int frame_width = 0;
+static int frame_height = 0;
+static int frames = 0;
+static int dropped = 0;
+
+// BT.601 limited range, 8 bits of fraction, as the SSE2 kernel computes them
+static inline Uint8 LumaOf(int r, int g, int b)
+{
+	return (Uint8)(((66*r + 129*g + 25*b + 128) >> 8) + 16);
+}
+
+static inline Uint8 BlueChromaOf(int r, int g, int b)
+{
+	return (Uint8)(((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+}
+
+static inline Uint8 RedChromaOf(int r, int g, int b)
+{
+	return (Uint8)(((112*r - 94*g - 18*b + 128) >> 8) + 128);
+}
+
+// Pixels from x to width of a row pair, x even; row1 is row0 again on the last odd row
+static void ConvertRowsScalar(const Uint32* row0, const Uint32* row1, int x, int width, Uint8* y0, Uint8* y1, Uint8* u, Uint8* v)
+{
+	for (int i = x; i < width; ++i)
+	{
+		y0[i] = LumaOf((row0[i] >> 16) & 0xFF, (row0[i] >> 8) & 0xFF, row0[i] & 0xFF);
+		if (y1 != NULL) y1[i] = LumaOf((row1[i] >> 16) & 0xFF, (row1[i] >> 8) & 0xFF, row1[i] & 0xFF);
+	}
+
+	for (int i = x; i < width; i += 2)
+	{
+		int right = SDL_min(i + 1, width - 1);
+		int r = 2, g = 2, b = 2;
+
+		// Sum of the 2x2 block, rounded when averaged
+		const Uint32 block[4] = { row0[i], row0[right], row1[i], row1[right] };
+		for (int k = 0; k < 4; ++k)
+		{
+			r += (block[k] >> 16) & 0xFF;
+			g += (block[k] >> 8) & 0xFF;
+			b += block[k] & 0xFF;
+		}
+
+		u[i/2] = BlueChromaOf(r >> 2, g >> 2, b >> 2);
+		v[i/2] = RedChromaOf(r >> 2, g >> 2, b >> 2);
+	}
+}
+
+#if defined(__SSE2__)
+// 8 ARGB8888 pixels into 16-bit R, G and B lanes
+static inline void SplitPixels(const Uint32* pixels, __m128i* r, __m128i* g, __m128i* b)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	__m128i p0 = _mm_loadu_si128((const __m128i*)pixels);
+	__m128i p1 = _mm_loadu_si128((const __m128i*)(pixels + 4));
+
+	*b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+	*r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+// NOTE: 66*255 + 129*255 + 25*255 + 128 still fits 16 unsigned bits, products wrap but the sum doesn't
+static inline void StoreLuma(__m128i r, __m128i g, __m128i b, Uint8* out)
+{
+	__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+	__m128i luma = _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+
+	_mm_storel_epi64((__m128i*)out, _mm_packus_epi16(luma, luma));
+}
+
+// Rounded average of the 2x2 blocks: 4 values, repeated in the high lanes
+static inline __m128i AverageBlocks(__m128i top, __m128i bottom)
+{
+	__m128i rows = _mm_add_epi16(top, bottom);
+	__m128i pairs = _mm_add_epi32(_mm_and_si128(rows, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(rows, 16));
+	__m128i average = _mm_srli_epi32(_mm_add_epi32(pairs, _mm_set1_epi32(2)), 2);
+
+	return _mm_packs_epi32(average, average);
+}
+
+// NOTE: Negative terms are added first, partial sums stay within signed 16 bits
+static inline void StoreChroma(__m128i r, __m128i g, __m128i b, Uint8* u, Uint8* v)
+{
+	__m128i bias = _mm_set1_epi16(128);
+	__m128i blue = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(-38)), _mm_mullo_epi16(g, _mm_set1_epi16(-74))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(112)), bias));
+	__m128i red = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(-94)), _mm_mullo_epi16(b, _mm_set1_epi16(-18))),
+		_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(112)), bias));
+
+	blue = _mm_add_epi16(_mm_srai_epi16(blue, 8), bias);
+	red = _mm_add_epi16(_mm_srai_epi16(red, 8), bias);
+
+	int packed = _mm_cvtsi128_si32(_mm_packus_epi16(blue, blue));
+	SDL_memcpy(u, &packed, 4);
+	packed = _mm_cvtsi128_si32(_mm_packus_epi16(red, red));
+	SDL_memcpy(v, &packed, 4);
+}
+#endif
+
+// ----------------------------------------------------------------
+void ConvertFrameYUV(const Uint32* pixels, int pitch, int width, int height, Uint8* y_plane, Uint8* u_plane, Uint8* v_plane)
+{
+	int chroma_width = (width + 1)/2;
+
+	for (int y = 0; y < height; y += 2)
+	{
+		const Uint32* row0 = (const Uint32*)((const Uint8*)pixels + y*pitch);
+		const Uint32* row1 = (y + 1 < height)? (const Uint32*)((const Uint8*)row0 + pitch) : row0;
+		Uint8* y0 = y_plane + y*width;
+		Uint8* y1 = (y + 1 < height)? y0 + width : NULL;
+		Uint8* u = u_plane + (y/2)*chroma_width;
+		Uint8* v = v_plane + (y/2)*chroma_width;
+		int x = 0;
+
+#if defined(__SSE2__)
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i r0, g0, b0, r1, g1, b1;
+			SplitPixels(row0 + x, &r0, &g0, &b0);
+			SplitPixels(row1 + x, &r1, &g1, &b1);
+
+			StoreLuma(r0, g0, b0, y0 + x);
+			if (y1 != NULL) StoreLuma(r1, g1, b1, y1 + x);
+
+			StoreChroma(AverageBlocks(r0, r1), AverageBlocks(g0, g1), AverageBlocks(b0, b1), u + x/2, v + x/2);
+		}
+#endif
+
+		ConvertRowsScalar(row0, row1, x, width, y0, y1, u, v);
+	}
+}
+
+static void WriteFrame(const Uint32* pixels)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	int pitch = frame_width*(int)sizeof(Uint32);
+
+	if (writer.png)
+	{
+		char file_name[CAPTURE_PATH_SIZE];
+		SDL_snprintf(file_name, sizeof(file_name), "%s/frame_%06i.png", writer.path, writer.written);
+
+		SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormatFrom((void*)pixels, frame_width, frame_height, 32, pitch, CAPTURE_FORMAT);
+		if ((frame == NULL) || (IMG_SavePNG(frame, file_name) != 0)) printf("WARNING: Unable to save captured frame %s! SDL Error: %s\n", file_name, SDL_GetError());
+		SDL_FreeSurface(frame);
+	}
+	else
+	{
+		int luma_size = frame_width*frame_height;
+		int chroma_size = ((frame_width + 1)/2)*((frame_height + 1)/2);
+
+		ConvertFrameYUV(pixels, pitch, frame_width, frame_height, writer.planes, writer.planes + luma_size, writer.planes + luma_size + chroma_size);
+
+		SDL_RWwrite(writer.video, "FRAME\n", 1, 6);
+		SDL_RWwrite(writer.video, writer.planes, 1, luma_size + 2*chroma_size);
+	}
+
+	writer.written++;
+	writer.write_time += SDL_GetPerformanceCounter() - start;
+}
+
+// Write frames as they come, the ones left are written before stopping
+static int SDLCALL CaptureThread(void* data)
+{
+	int index;
+
+	for (;;)
+	{
+		if (filled.Pop(&index))
+		{
+			WriteFrame(buffers[index]);
+			free_buffers.Push(index);
+		}
+		else if (!SDL_AtomicGet(&running)) break;
+		else SDL_SemWait(wake);
+	}
+
+	return 0;
+}
+
+// ----------------------------------------------------------------
+bool StartCapture(const char* path, int width, int height)
+{
+	int length = (int)SDL_strlen(path);
+
+	SDL_zero(writer);
+	SDL_strlcpy(writer.path, path, sizeof(writer.path));
+	writer.png = (length < 4) || (SDL_strcasecmp(path + length - 4, ".y4m") != 0);
+	frame_width = width;
+	frame_height = height;
+	frames = 0;
+	dropped = 0;
+	held = -1;
+	filled.Clear();
+	free_buffers.Clear();
+
+	if (!writer.png)
+	{
+		writer.video = SDL_RWFromFile(path, "wb");
+		if (writer.video == NULL)
+		{
+			printf("WARNING: Unable to open capture file %s! SDL Error: %s\n", path, SDL_GetError());
+			return false;
+		}
+
+		char header[64];
+		int header_size = SDL_snprintf(header, sizeof(header), "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg\n", width, height, SIM_TICK_RATE);
+		SDL_RWwrite(writer.video, header, 1, header_size);
+
+		writer.planes = (Uint8*)SDL_malloc(width*height + 2*((width + 1)/2)*((height + 1)/2));
+		if (writer.planes == NULL)
+		{
+			printf("WARNING: Unable to allocate capture planes!\n");
+			StopCapture();
+			return false;
+		}
+	}
+
+	for (int i = 0; i < CAPTURE_BUFFERS; ++i)
+	{
+		buffers[i] = (Uint32*)SDL_SIMDAlloc(width*height*sizeof(Uint32));
+		if (buffers[i] != NULL) free_buffers.Push(i);
+	}
+
+	SDL_AtomicSet(&running, 1);
+	wake = SDL_CreateSemaphore(0);
+	if (wake != NULL) thread = SDL_CreateThread(CaptureThread, "Capture", NULL);
+
+	if (thread == NULL)
+	{
+		printf("WARNING: Unable to create capture thread! SDL Error: %s\n", SDL_GetError());
+		StopCapture();
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void StopCapture()
+{
+	SDL_AtomicSet(&running, 0);
+
+	if (thread != NULL)
+	{
+		SDL_SemPost(wake);
+		SDL_WaitThread(thread, NULL);
+	}
+	if (wake != NULL) SDL_DestroySemaphore(wake);
+	thread = NULL;
+	wake = NULL;
+
+	if (writer.video != NULL) SDL_RWclose(writer.video);
+	writer.video = NULL;
+	SDL_free(writer.planes);
+	writer.planes = NULL;
+
+	for (int i = 0; i < CAPTURE_BUFFERS; ++i)
+	{
+		SDL_SIMDFree(buffers[i]);
+		buffers[i] = NULL;
+	}
+}
+
+// ----------------------------------------------------------------
+bool CaptureFrame(SDL_Renderer* renderer)
+{
+	if (thread == NULL) return false;
+
+	frames++;
+
+	int index = held;
+	if ((index < 0) && !free_buffers.Pop(&index))
+	{
+		dropped++;
+		return false;
+	}
+
+	SDL_Rect rec = { 0, 0, frame_width, frame_height };
+	if (SDL_RenderReadPixels(renderer, &rec, CAPTURE_FORMAT, buffers[index], frame_width*(int)sizeof(Uint32)) != 0)
+	{
+		// Kept for the next frame, only the writer gives buffers back
+		held = index;
+		dropped++;
+		return false;
+	}
+
+	held = -1;
+	filled.Push(index);
+	SDL_SemPost(wake);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+// NOTE: Writer figures are final once capture stopped
+CaptureStats GetCaptureStats()
+{
+	CaptureStats stats;
+
+	stats.frames = frames;
+	stats.dropped = dropped;
+	stats.written = writer.written;
+	stats.avg_write_ms = (writer.written > 0)? (float)(writer.write_time*1000.0/SDL_GetPerformanceFrequency()/writer.written) : 0.0f;
+
+	return stats;
+}
@@ -0,0 +1,50 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Capture - Gameplay video recorded from the presented frames
+//
+// Every simulation tick drawn is read back from the renderer, before the
+// present, into one of CAPTURE_BUFFERS preallocated frames and handed to
+// the writer thread through a SpscQueue (see Queue.h); the writer gives
+// the frame back through another one once written. When the writer falls
+// behind and no frame is free the game does not wait: the frame is
+// dropped and counted, so capturing never stalls the frame.
+//
+// The writer converts frames to Y4M (raw YUV 4:2:0, BT.601 limited range,
+// SSE2 where available) at SIM_TICK_RATE frames per second, or saves
+// them as a PNG sequence when the capture path is not a .y4m file.
+//
+// NOTE: SDL 2 has no asynchronous readback, the copy itself still waits
+// for the GPU; conversion, encoding and disk writes are off the frame.
+// -------------------------------------------------------------------------
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define CAPTURE_BUFFERS			   4		// Frames read back and waiting for the writer
+#define CAPTURE_FORMAT		SDL_PIXELFORMAT_ARGB8888
+#define CAPTURE_PATH_SIZE		 512
+
+struct CaptureStats
+{
+	int frames;					// Read back
+	int dropped;				// No free buffer, the writer was behind
+	int written;
+	float avg_write_ms;			// Writer time per frame, conversion included
+};
+
+// Start capturing width x height frames to path: a .y4m video, or a folder the frame_NNNNNN.png files go to
+bool StartCapture(const char* path, int width, int height);
+void StopCapture();
+
+// Read back what renderer drew this frame, call before SDL_RenderPresent()
+// NOTE: Main thread only, returns false if the frame was dropped
+bool CaptureFrame(SDL_Renderer* renderer);
+
+CaptureStats GetCaptureStats();
+
+// Convert an ARGB8888 frame to the Y, U and V planes of 4:2:0 video, U and V are (width + 1)/2 x (height + 1)/2
+void ConvertFrameYUV(const Uint32* pixels, int pitch, int width, int height, Uint8* y_plane, Uint8* u_plane, Uint8* v_plane);
+
+#endif // __CAPTURE_H__
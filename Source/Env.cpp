@@ -0,0 +1,300 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Env - Learning environments over the simulation
+// -------------------------------------------------------------------------
+
+#include "Env.h"
+#include "Input.h"
+#include "Jobs.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#define FRAME_SHOT			 255		// Frame gray levels
+#define FRAME_SHIP			 128
+
+// One StepEnvs() call, jobs only write the games of their lane groups
+struct EnvStep
+{
+	EnvBatch* envs;
+	const Uint8* actions;
+	float* rewards;
+	Uint8* dones;
+};
+
+static const Uint32 action_masks[ENV_ACTION_COUNT] =
+{
+	0,
+	ACTION_BIT(ACTION_MOVE_LEFT),
+	ACTION_BIT(ACTION_MOVE_RIGHT)
+};
+
+// Gray rectangle, screen coordinates scaled down to the frame and clipped
+static void FillFrameRect(Uint8* frame, int x, int y, int width, int height, Uint8 gray)
+{
+	int x0 = SDL_max(0, x*ENV_FRAME_SIZE/SCREEN_WIDTH);
+	int y0 = SDL_max(0, y*ENV_FRAME_SIZE/SCREEN_HEIGHT);
+	int x1 = SDL_min(ENV_FRAME_SIZE, ((x + width)*ENV_FRAME_SIZE + SCREEN_WIDTH - 1)/SCREEN_WIDTH);
+	int y1 = SDL_min(ENV_FRAME_SIZE, ((y + height)*ENV_FRAME_SIZE + SCREEN_HEIGHT - 1)/SCREEN_HEIGHT);
+
+	for (int row = y0; row < y1; ++row) if (x1 > x0) SDL_memset(frame + row*ENV_FRAME_SIZE + x0, gray, x1 - x0);
+}
+
+// Screen as drawn, background left black: asteroids on top of the ship
+static void WriteFrame(const SimLanes* lanes, int lane, Uint8* frame)
+{
+	SDL_memset(frame, 0, ENV_FRAME_SIZE*ENV_FRAME_SIZE);
+
+	if (lanes->ships_alive[lane] & 1) FillFrameRect(frame, lanes->ship_x[0][lane], lanes->ship_y[lane], SHIP_SIZE, SHIP_SIZE, FRAME_SHIP);
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((lanes->alive[lane] & (1u << i)) == 0) continue;
+
+		FillFrameRect(frame, lanes->shot_x[i][lane], lanes->shot_y[i][lane], SHOT_DRAW_WIDTH, SHOT_DRAW_HEIGHT, FRAME_SHOT);
+	}
+}
+
+// Features, all of them about 0 to 1:
+//   [0] ship x over the screen width
+//   [1] direction held last step: -1 left, 1 right, 0 none
+//   [2 + lane*ENV_WAVES_SEEN + k] distance from the ship bottom up to the k-th
+//       asteroid of the wave lane, over the screen height, 1 if none
+static void WriteFeatures(const SimLanes* lanes, int lane, float* features)
+{
+	Uint32 held = (Uint32)lanes->actions[lane];
+	int bottom = lanes->ship_y[lane] + SHIP_SIZE;
+
+	features[0] = (float)lanes->ship_x[0][lane]/SCREEN_WIDTH;
+	features[1] = (held & ACTION_BIT(ACTION_MOVE_LEFT))? -1.0f : ((held & ACTION_BIT(ACTION_MOVE_RIGHT))? 1.0f : 0.0f);
+
+	float* seen = &features[2];
+	for (int f = 0; f < WAVE_LANES*ENV_WAVES_SEEN; ++f) seen[f] = 1.0f;
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((lanes->alive[lane] & (1u << i)) == 0) continue;
+		if (lanes->shot_y[i][lane] >= bottom) continue;
+
+		int wave_lane = SDL_max(0, SDL_min((lanes->shot_x[i][lane] - WAVE_FIRST_LANE_X)/WAVE_LANE_WIDTH, WAVE_LANES - 1));
+		float* nearest = &seen[wave_lane*ENV_WAVES_SEEN];
+		float distance = (float)(bottom - lanes->shot_y[i][lane])/SCREEN_HEIGHT;
+
+		// Keep the closest ones sorted
+		for (int k = 0; k < ENV_WAVES_SEEN; ++k)
+		{
+			if (distance >= nearest[k]) continue;
+
+			for (int m = ENV_WAVES_SEEN - 1; m > k; --m) nearest[m] = nearest[m - 1];
+			nearest[k] = distance;
+			break;
+		}
+	}
+}
+
+static void WriteObservation(EnvBatch* envs, int env)
+{
+	const SimLanes* lanes = &envs->lanes[env/SIM_LANES];
+	Uint8* out = envs->observations + (size_t)env*envs->observation_size;
+
+	if (envs->observation == OBSERVE_FRAME) WriteFrame(lanes, env%SIM_LANES, out);
+	else WriteFeatures(lanes, env%SIM_LANES, (float*)out);
+}
+
+// Title skipped, the episode starts on the first gameplay tick
+static void StartEpisode(EnvBatch* envs, int env, Uint32 seed)
+{
+	SimState sim;
+
+	InitSim(&sim, seed, 1);
+	MoveStuff(&sim, ACTION_BIT(ACTION_CONFIRM), NULL);
+
+	SetSimLane(&envs->lanes[env/SIM_LANES], env%SIM_LANES, &sim);
+	envs->seeds[env] = seed;
+	envs->start_ticks[env] = sim.tick;
+}
+
+// Job body: lane groups [begin, end), nested parallel loops (episode resets) run inline
+static void StepGroups(int begin, int end, void* data)
+{
+	EnvStep* step = (EnvStep*)data;
+	EnvBatch* envs = step->envs;
+
+	SetSerialJobs(true);
+
+	for (int group = begin; group < end; ++group)
+	{
+		SimLanes* lanes = &envs->lanes[group];
+		int first = group*SIM_LANES;
+		int count = SDL_min(SIM_LANES, envs->count - first);
+		Uint32 held[SIM_LANES] = { 0 };
+
+		// Spare lanes hold nothing, their games wait on the title screen
+		for (int lane = 0; lane < count; ++lane) held[lane] = action_masks[SDL_min(step->actions[first + lane], ENV_ACTION_COUNT - 1)];
+
+		MoveStuffLanes(lanes, held);
+
+		for (int lane = 0; lane < count; ++lane)
+		{
+			int env = first + lane;
+			bool hit = (lanes->screen[lane] != GAMEPLAY);
+			Uint32 ticks = lanes->tick[lane] - envs->start_ticks[env];
+			bool done = hit || ((envs->max_ticks > 0) && (ticks >= (Uint32)envs->max_ticks));
+
+			step->rewards[env] = hit? ENV_HIT_REWARD : ENV_TICK_REWARD;
+			step->dones[env] = done? 1 : 0;
+			envs->episode_ends[env] = ticks;
+
+			if (done) StartEpisode(envs, env, envs->seeds[env] + envs->count);
+			WriteObservation(envs, env);
+		}
+	}
+
+	SetSerialJobs(false);
+}
+
+// ----------------------------------------------------------------
+int GetEnvObservationSize(EnvObservation observation)
+{
+	return (observation == OBSERVE_FRAME)? ENV_FRAME_SIZE*ENV_FRAME_SIZE : ENV_FEATURES*(int)sizeof(float);
+}
+
+// ----------------------------------------------------------------
+bool CreateEnvs(EnvBatch* envs, int count, EnvObservation observation, int max_ticks, Uint32 seed, void* observations)
+{
+	SDL_zerop(envs);
+
+	if ((count <= 0) || (observations == NULL)) return false;
+
+	envs->count = count;
+	envs->groups = (count + SIM_LANES - 1)/SIM_LANES;
+	envs->observation = observation;
+	envs->observation_size = GetEnvObservationSize(observation);
+	envs->max_ticks = max_ticks;
+	envs->observations = (Uint8*)observations;
+
+	// NOTE: SimLanes are loaded with aligned SSE2 loads
+	envs->lanes = (SimLanes*)SDL_SIMDAlloc(envs->groups*sizeof(SimLanes));
+	envs->seeds = (Uint32*)SDL_malloc(count*sizeof(Uint32));
+	envs->start_ticks = (Uint32*)SDL_malloc(count*sizeof(Uint32));
+	envs->episode_ends = (Uint32*)SDL_malloc(count*sizeof(Uint32));
+
+	if ((envs->lanes == NULL) || (envs->seeds == NULL) || (envs->start_ticks == NULL) || (envs->episode_ends == NULL))
+	{
+		printf("WARNING: Cannot allocate %i environments\n", count);
+		DestroyEnvs(envs);
+		return false;
+	}
+
+	// Spare lanes play a title screen nobody watches
+	SimState idle;
+	InitSim(&idle, seed, 1);
+	for (int group = 0; group < envs->groups; ++group) for (int lane = 0; lane < SIM_LANES; ++lane) SetSimLane(&envs->lanes[group], lane, &idle);
+
+	for (int env = 0; env < count; ++env) ResetEnv(envs, env, seed + env);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void DestroyEnvs(EnvBatch* envs)
+{
+	SDL_SIMDFree(envs->lanes);
+	SDL_free(envs->seeds);
+	SDL_free(envs->start_ticks);
+	SDL_free(envs->episode_ends);
+	SDL_zerop(envs);
+}
+
+// ----------------------------------------------------------------
+void ResetEnv(EnvBatch* envs, int env, Uint32 seed)
+{
+	StartEpisode(envs, env, seed);
+	WriteObservation(envs, env);
+}
+
+// ----------------------------------------------------------------
+void StepEnvs(EnvBatch* envs, const Uint8* actions, float* rewards, Uint8* dones)
+{
+	EnvStep step;
+	step.envs = envs;
+	step.actions = actions;
+	step.rewards = rewards;
+	step.dones = dones;
+
+	ParallelFor(envs->groups, ENV_GROUP_JOBS, StepGroups, &step);
+
+	// Reduce in game order
+	for (int env = 0; env < envs->count; ++env)
+	{
+		if (dones[env] == 0) continue;
+
+		envs->stats.episodes++;
+		envs->episode_ticks += envs->episode_ends[env];
+	}
+
+	envs->stats.steps += envs->count;
+}
+
+// ----------------------------------------------------------------
+EnvStats GetEnvStats(const EnvBatch* envs)
+{
+	EnvStats stats = envs->stats;
+	stats.avg_episode_ticks = (stats.episodes > 0)? (float)envs->episode_ticks/stats.episodes : 0.0f;
+
+	return stats;
+}
+
+// ----------------------------------------------------------------
+void RunEnvBenchmark()
+{
+	const int counts[] = { 8, 64, 512, 4096 };
+	const int steps = 2000;
+	Uint32 rng = 1234;
+
+	printf("Environment benchmark: %i steps, random actions, %i job workers\n", steps, GetJobStats().workers);
+	printf("%8s %10s %14s %14s %12s\n", "games", "observe", "steps/s", "MB/s written", "avg episode");
+
+	for (int c = 0; c < (int)(sizeof(counts)/sizeof(counts[0])); ++c)
+	{
+		for (int o = OBSERVE_FEATURES; o <= OBSERVE_FRAME; ++o)
+		{
+			int count = counts[c];
+			EnvObservation observation = (EnvObservation)o;
+			void* buffer = SDL_malloc((size_t)count*GetEnvObservationSize(observation));
+			Uint8* actions = (Uint8*)SDL_calloc(count, 1);
+			float* rewards = (float*)SDL_malloc(count*sizeof(float));
+			Uint8* dones = (Uint8*)SDL_malloc(count);
+			EnvBatch envs;
+
+			if (CreateEnvs(&envs, count, observation, 0, 1, buffer))
+			{
+				Uint64 start = SDL_GetPerformanceCounter();
+
+				for (int s = 0; s < steps; ++s)
+				{
+					// Actions change every few steps, held ones move the ship
+					for (int env = 0; env < count; ++env)
+					{
+						NextRandom(&rng);
+						if ((rng & 7) == 0) actions[env] = (Uint8)((rng >> 8)%ENV_ACTION_COUNT);
+					}
+
+					StepEnvs(&envs, actions, rewards, dones);
+				}
+
+				double seconds = (double)(SDL_GetPerformanceCounter() - start)/SDL_GetPerformanceFrequency();
+				EnvStats stats = GetEnvStats(&envs);
+
+				printf("%8i %10s %14.0f %14.1f %12.1f\n", count, (observation == OBSERVE_FRAME)? "frame" : "features",
+					stats.steps/seconds, stats.steps*envs.observation_size/seconds/(1024.0*1024.0), stats.avg_episode_ticks);
+
+				DestroyEnvs(&envs);
+			}
+
+			SDL_free(dones);
+			SDL_free(rewards);
+			SDL_free(actions);
+			SDL_free(buffer);
+		}
+	}
+}
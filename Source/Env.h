@@ -0,0 +1,94 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Env - Learning environments over the simulation
+//
+// An EnvBatch steps many single player games at once, SIM_LANES per
+// SimLanes (see Lanes.h) and the lane groups spread over the job workers.
+// Every step the agent picks an EnvAction per game, gets a reward per
+// tick survived and done when the ship is hit or the episode is too long.
+// Episodes skip title and ending: reset starts playing right away and
+// done games restart on their own, from their next seed.
+//
+// Observations are written straight from the lanes into the buffer the
+// caller hands in (shared memory with the trainer, for example), game g
+// at g*GetEnvObservationSize(): no SimState copies and no renderer.
+//   OBSERVE_FEATURES: ENV_FEATURES floats, see WriteFeatures()
+//   OBSERVE_FRAME: ENV_FRAME_SIZE^2 bytes, grayscale downsampled screen
+// -------------------------------------------------------------------------
+
+#ifndef __ENV_H__
+#define __ENV_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+#include "Lanes.h"
+
+#define ENV_WAVES_SEEN		   2		// Asteroids above the ship seen per lane
+#define ENV_FEATURES		(2 + WAVE_LANES*ENV_WAVES_SEEN)
+#define ENV_FRAME_SIZE		  84		// Downsampled screen side, pixels
+#define ENV_GROUP_JOBS		   1		// Lane groups per job
+
+#define ENV_TICK_REWARD		1.0f	// Every tick the ship survives
+#define ENV_HIT_REWARD	   -1.0f	// The tick the ship is hit
+
+enum EnvAction
+{
+	ENV_NOOP = 0,
+	ENV_LEFT,						// Held, the ship moves from the second tick held on
+	ENV_RIGHT,
+	ENV_ACTION_COUNT
+};
+
+enum EnvObservation
+{
+	OBSERVE_FEATURES = 0,
+	OBSERVE_FRAME
+};
+
+struct EnvStats
+{
+	Uint64 steps;					// Game ticks, every game included
+	int episodes;					// Finished
+	float avg_episode_ticks;
+};
+
+struct EnvBatch
+{
+	int count;
+	int groups;						// Lane groups, the last one may have spare lanes
+	EnvObservation observation;
+	int observation_size;			// Bytes per game
+	int max_ticks;					// Episode length limit, 0 for none
+	Uint8* observations;			// Caller buffer
+
+	SimLanes* lanes;
+	Uint32* seeds;					// Seed of the episode playing
+	Uint32* start_ticks;			// Tick the episode started
+	Uint32* episode_ends;			// Ticks played by the episodes that ended last step
+
+	Uint64 episode_ticks;
+	EnvStats stats;
+};
+
+// Bytes per game in the observations buffer
+int GetEnvObservationSize(EnvObservation observation);
+
+// Set up count games, game g seeded seed + g and observed into observations (count*GetEnvObservationSize() bytes)
+// NOTE: The buffer stays the caller's, it must outlive the batch
+bool CreateEnvs(EnvBatch* envs, int count, EnvObservation observation, int max_ticks, Uint32 seed, void* observations);
+void DestroyEnvs(EnvBatch* envs);
+
+// Start a new episode of game env and write its first observation
+void ResetEnv(EnvBatch* envs, int env, Uint32 seed);
+
+// Step every game with its EnvAction, write rewards, dones (1 when the episode ended) and observations
+// NOTE: Done games already restarted, their observation is the first one of the next episode
+void StepEnvs(EnvBatch* envs, const Uint8* actions, float* rewards, Uint8* dones);
+
+EnvStats GetEnvStats(const EnvBatch* envs);
+
+// Steps per second for both observations and a few batch sizes, random actions
+void RunEnvBenchmark();
+
+#endif // __ENV_H__
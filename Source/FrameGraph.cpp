@@ -0,0 +1,275 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// FrameGraph - Frame as a graph of tasks run on the job system
+// -------------------------------------------------------------------------
+
+#include "FrameGraph.h"
+#include "Jobs.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+struct FrameTask
+{
+	const char* name;
+	FrameTaskFunction function;
+	Uint32 reads;
+	Uint32 writes;
+	TaskThread thread;
+
+	int dependencies[MAX_FRAME_TASKS];
+	int dependency_count;
+	int dependents[MAX_FRAME_TASKS];
+	int dependent_count;
+	SDL_atomic_t remaining;			// Dependencies not finished yet this frame
+};
+
+struct TaskTiming
+{
+	Uint64 start;
+	Uint64 end;
+	SDL_threadID thread;
+};
+
+static FrameTask tasks[MAX_FRAME_TASKS];
+static int task_count = 0;
+
+static SDL_atomic_t pending;		// Tasks not finished yet this frame
+static SDL_atomic_t main_ready;		// Main thread tasks ready to run, one bit per task
+static SDL_sem* main_wake = NULL;	// Posted when main thread has something to do
+static SDL_threadID main_thread = 0;
+
+// Last frames timings, indexed by frame%FRAME_TRACE_FRAMES
+static TaskTiming timings[FRAME_TRACE_FRAMES][MAX_FRAME_TASKS];
+static Uint64 frame_starts[FRAME_TRACE_FRAMES];
+static Uint32 critical_masks[FRAME_TRACE_FRAMES];
+static Uint32 frame = 0;
+
+static Uint64 task_times[MAX_FRAME_TASKS];
+static int critical_counts[MAX_FRAME_TASKS];
+static Uint64 frame_time = 0;
+
+static void ScheduleTask(int index);
+
+static void RunTask(int index)
+{
+	FrameTask* task = &tasks[index];
+	TaskTiming* timing = &timings[frame%FRAME_TRACE_FRAMES][index];
+
+	timing->thread = SDL_ThreadID();
+	timing->start = SDL_GetPerformanceCounter();
+	task->function();
+	timing->end = SDL_GetPerformanceCounter();
+
+	for (int i = 0; i < task->dependent_count; ++i)
+	{
+		int dependent = task->dependents[i];
+		if (SDL_AtomicAdd(&tasks[dependent].remaining, -1) == 1) ScheduleTask(dependent);
+	}
+
+	// Last task of the frame, let the main thread return
+	if (SDL_AtomicAdd(&pending, -1) == 1) SDL_SemPost(main_wake);
+}
+
+static void TaskJob(int begin, int end, void* data)
+{
+	RunTask(begin);
+}
+
+static void ScheduleTask(int index)
+{
+	if (tasks[index].thread == TASK_MAIN_THREAD)
+	{
+		int ready;
+		do ready = SDL_AtomicGet(&main_ready);
+		while (!SDL_AtomicCAS(&main_ready, ready, ready | (1 << index)));
+
+		SDL_SemPost(main_wake);
+	}
+	else RunJob(TaskJob, NULL, index, index + 1, NULL);
+}
+
+// Walk back from the last task to finish: every task was let start either by
+// its latest dependency to finish or by the previous task run on the same thread
+static void AccumulateCriticalPath()
+{
+	TaskTiming* timing = timings[frame%FRAME_TRACE_FRAMES];
+	Uint32 mask = 0;
+	int current = 0;
+
+	for (int i = 1; i < task_count; ++i) if (timing[i].end > timing[current].end) current = i;
+
+	for (int steps = 0; (current >= 0) && (steps < task_count); ++steps)
+	{
+		FrameTask* task = &tasks[current];
+		int enabler = -1;
+
+		mask |= (1u << current);
+
+		for (int i = 0; i < task->dependency_count; ++i)
+		{
+			int dependency = task->dependencies[i];
+			if ((enabler < 0) || (timing[dependency].end > timing[enabler].end)) enabler = dependency;
+		}
+
+		for (int i = 0; i < task_count; ++i)
+		{
+			if ((i == current) || (timing[i].thread != timing[current].thread) || (timing[i].end > timing[current].start)) continue;
+			if ((enabler < 0) || (timing[i].end > timing[enabler].end)) enabler = i;
+		}
+
+		current = enabler;
+	}
+
+	critical_masks[frame%FRAME_TRACE_FRAMES] = mask;
+
+	for (int i = 0; i < task_count; ++i)
+	{
+		task_times[i] += timing[i].end - timing[i].start;
+		if (mask & (1u << i)) critical_counts[i]++;
+	}
+}
+
+// ----------------------------------------------------------------
+void InitFrameGraph()
+{
+	task_count = 0;
+	frame = 0;
+	frame_time = 0;
+	SDL_zeroa(task_times);
+	SDL_zeroa(critical_counts);
+
+	main_thread = SDL_ThreadID();
+	main_wake = SDL_CreateSemaphore(0);
+	if (main_wake == NULL) printf("WARNING: Unable to create frame graph semaphore! SDL Error: %s\n", SDL_GetError());
+}
+
+// ----------------------------------------------------------------
+void CloseFrameGraph()
+{
+	if (main_wake != NULL) SDL_DestroySemaphore(main_wake);
+	main_wake = NULL;
+	task_count = 0;
+}
+
+// ----------------------------------------------------------------
+int AddFrameTask(const char* name, FrameTaskFunction function, Uint32 reads, Uint32 writes, TaskThread thread)
+{
+	if (task_count == MAX_FRAME_TASKS)
+	{
+		printf("WARNING: Too many frame tasks, %s not added\n", name);
+		return -1;
+	}
+
+	int index = task_count++;
+	FrameTask* task = &tasks[index];
+
+	task->name = name;
+	task->function = function;
+	task->reads = reads;
+	task->writes = writes;
+	task->thread = thread;
+	task->dependency_count = 0;
+	task->dependent_count = 0;
+
+	for (int i = 0; i < index; ++i)
+	{
+		// Read after write, write after write and write after read
+		if ((tasks[i].writes & (reads | writes)) || (tasks[i].reads & writes))
+		{
+			task->dependencies[task->dependency_count++] = i;
+			tasks[i].dependents[tasks[i].dependent_count++] = index;
+		}
+	}
+
+	return index;
+}
+
+// ----------------------------------------------------------------
+void RunFrameGraph()
+{
+	if ((task_count == 0) || (main_wake == NULL)) return;
+
+	frame_starts[frame%FRAME_TRACE_FRAMES] = SDL_GetPerformanceCounter();
+
+	SDL_AtomicSet(&pending, task_count);
+	SDL_AtomicSet(&main_ready, 0);
+	for (int i = 0; i < task_count; ++i) SDL_AtomicSet(&tasks[i].remaining, tasks[i].dependency_count);
+
+	for (int i = 0; i < task_count; ++i) if (tasks[i].dependency_count == 0) ScheduleTask(i);
+
+	while (SDL_AtomicGet(&pending) > 0)
+	{
+		int ready = SDL_AtomicSet(&main_ready, 0);
+
+		// NOTE: Waiting is the main thread idle time, the only thread allowed to pump
+		if (ready == 0)
+		{
+			if (SDL_SemWaitTimeout(main_wake, FRAME_PUMP_MS) == SDL_MUTEX_TIMEDOUT) PumpInput();
+		}
+		else
+		{
+			// Ready main thread tasks run in declaration order
+			for (int i = 0; i < task_count; ++i) if (ready & (1 << i)) RunTask(i);
+		}
+	}
+
+	frame_time += SDL_GetPerformanceCounter() - frame_starts[frame%FRAME_TRACE_FRAMES];
+	AccumulateCriticalPath();
+	frame++;
+}
+
+// ----------------------------------------------------------------
+void PrintFrameGraphReport()
+{
+	if (frame == 0) return;
+
+	double ms = 1000.0/SDL_GetPerformanceFrequency();
+
+	printf("Frame graph: %u frames, %.2f ms average frame\n", frame, frame_time*ms/frame);
+
+	for (int i = 0; i < task_count; ++i)
+	{
+		printf("  %-16s %-4s %7.3f ms average, critical path in %3i%% of frames\n", tasks[i].name,
+			(tasks[i].thread == TASK_MAIN_THREAD)? "main" : "any", task_times[i]*ms/frame, (int)((Uint64)critical_counts[i]*100/frame));
+	}
+}
+
+// ----------------------------------------------------------------
+bool WriteFrameTrace(const char* file_name)
+{
+	SDL_RWops* file = SDL_RWFromFile(file_name, "w");
+
+	if (file == NULL)
+	{
+		printf("WARNING: Unable to write frame trace %s! SDL Error: %s\n", file_name, SDL_GetError());
+		return false;
+	}
+
+	Uint32 first = (frame > FRAME_TRACE_FRAMES)? frame - FRAME_TRACE_FRAMES : 0;
+	Uint64 origin = frame_starts[first%FRAME_TRACE_FRAMES];
+	double us = 1000000.0/SDL_GetPerformanceFrequency();
+	char line[256];
+
+	int length = SDL_snprintf(line, sizeof(line), "{\"traceEvents\":[\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"Main\"}}",
+		(unsigned long)main_thread);
+	SDL_RWwrite(file, line, 1, length);
+
+	for (Uint32 f = first; f < frame; ++f)
+	{
+		TaskTiming* timing = timings[f%FRAME_TRACE_FRAMES];
+
+		for (int i = 0; i < task_count; ++i)
+		{
+			length = SDL_snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u,\"critical\":%s}}",
+				tasks[i].name, (unsigned long)timing[i].thread, (double)(Sint64)(timing[i].start - origin)*us, (double)(timing[i].end - timing[i].start)*us,
+				f, (critical_masks[f%FRAME_TRACE_FRAMES] & (1u << i))? "true" : "false");
+			SDL_RWwrite(file, line, 1, length);
+		}
+	}
+
+	SDL_RWwrite(file, "\n]}\n", 1, 4);
+	SDL_RWclose(file);
+
+	return true;
+}
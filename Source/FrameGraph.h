@@ -0,0 +1,52 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// FrameGraph - Frame as a graph of tasks run on the job system
+//
+// Tasks declare the state sections they read and write, dependencies
+// come from declaration order: a task waits for earlier tasks writing
+// what it touches and for earlier tasks reading what it writes. Ready
+// tasks run on job workers, except the ones pinned to the main thread.
+//
+// While the main thread waits for tasks it keeps pumping input every
+// FRAME_PUMP_MS, so key edges get stamped when they arrive, not at the
+// next frame start.
+//
+// Task timings of the last frames are kept for a chrome://tracing dump,
+// and the critical path of every frame is accumulated for a report.
+// -------------------------------------------------------------------------
+
+#ifndef __FRAMEGRAPH_H__
+#define __FRAMEGRAPH_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define MAX_FRAME_TASKS		  16
+#define FRAME_TRACE_FRAMES	 600	// Last frames kept for the trace
+#define FRAME_PUMP_MS		   1	// Input pump period of the waiting main thread
+
+enum TaskThread
+{
+	TASK_ANY_THREAD = 0,
+	TASK_MAIN_THREAD			// SDL video, renderer and events only work on the main thread
+};
+
+typedef void (*FrameTaskFunction)();
+
+void InitFrameGraph();
+void CloseFrameGraph();
+
+// Add a task after all the previous ones, reads and writes are section bitmasks
+// NOTE: Only between frames, returns -1 if there is no room left
+int AddFrameTask(const char* name, FrameTaskFunction function, Uint32 reads, Uint32 writes, TaskThread thread);
+
+// Run every task once, returns when all of them finished
+// WARNING: Call it from the main thread
+void RunFrameGraph();
+
+// Average task times and how often each one was on the critical path
+void PrintFrameGraphReport();
+
+// Write the last frames in chrome://tracing JSON format
+bool WriteFrameTrace(const char* file_name);
+
+#endif // __FRAMEGRAPH_H__
@@ -0,0 +1,355 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Game - Simulation state and rules
+// -------------------------------------------------------------------------
+
+#include "Game.h"
+#include "Input.h"
+#include "Audio.h"
+#include "Jobs.h"
+#include "Hash.h"
+
+#include <stdio.h>			// Required for: printf()
+#include <stddef.h>			// Required for: offsetof()
+
+// Asteroid update results, reduced in order after the parallel pass
+#define SHOT_REACHED_BOTTOM	 0x01
+#define SHOT_LEFT_SCREEN	 0x02
+#define SHOT_HIT_SHIP		 0x04		// Shifted by the player hit
+
+// What a screen sees and reports during a tick
+struct TickContext
+{
+	KeyState left[MAX_PLAYERS];
+	KeyState right[MAX_PLAYERS];
+	KeyState confirm[MAX_PLAYERS];
+	Uint32 reflected;				// Actions that changed the game this tick
+	AudioCommandList* audio;
+};
+
+typedef void (*ScreenFunction)(SimState* sim, TickContext* tick);
+
+// Screen rules, enter and exit run once per transition
+struct ScreenRules
+{
+	ScreenFunction enter;
+	ScreenFunction exit;
+	ScreenFunction update;
+};
+
+// Parallel asteroids pass, jobs only read the state and write their events range
+struct AsteroidPass
+{
+	SimState* sim;
+	Uint8 events[MAX_SHIP_SHOTS];
+};
+
+static void QueueAudio(AudioCommandList* audio, AudioCommandType type, int value, int x)
+{
+	if (audio == NULL) return;
+
+	if (audio->count == MAX_AUDIO_COMMANDS)
+	{
+		audio->dropped++;
+		return;
+	}
+
+	audio->commands[audio->count].type = type;
+	audio->commands[audio->count].value = value;
+	audio->commands[audio->count].x = x;
+	audio->count++;
+}
+
+// Spawn one asteroid per lane, except the gap one
+static void SpawnWave(SimState* sim, int gap)
+{
+	if (sim->last_shot == MAX_SHIP_SHOTS) sim->last_shot = 0;
+
+	for (int lane = 0; lane < WAVE_LANES; ++lane)
+	{
+		if (lane == gap) continue;
+
+		sim->alive |= (1u << sim->last_shot);
+		sim->shot_x[sim->last_shot] = WAVE_FIRST_LANE_X + lane*WAVE_LANE_WIDTH;
+		sim->shot_y[sim->last_shot] = -20;
+		sim->last_shot++;
+	}
+}
+
+// Player p action a, as found in the tick actions mask
+static Uint32 PlayerActionBit(int player, Action action)
+{
+	return ACTION_BIT(action + player*PLAYER_ACTION_BITS);
+}
+
+// Any player pressed confirm this tick, returns which one or -1
+static int ConfirmPressed(const SimState* sim, const TickContext* tick)
+{
+	for (int p = 0; p < sim->players; ++p) if (tick->confirm[p] == KEY_DOWN) return p;
+
+	return -1;
+}
+
+// Move asteroids [begin, end) and test them against the ships
+// WARNING: Runs on job workers, only write asteroids positions and events in range
+static void UpdateAsteroids(int begin, int end, void* data)
+{
+	AsteroidPass* pass = (AsteroidPass*)data;
+	SimState* sim = pass->sim;
+
+	for (int i = begin; i < end; ++i)
+	{
+		Uint8 events = 0;
+
+		if (sim->alive & (1u << i))
+		{
+			if (sim->shot_y[i] < SCREEN_HEIGHT) sim->shot_y[i] += SHOT_SPEED;
+			else if (sim->shot_y[i] > SCREEN_HEIGHT + 100) events |= SHOT_LEFT_SCREEN;
+			else events |= SHOT_REACHED_BOTTOM;
+		}
+
+		// NOTE: Asteroids collide as a point against the ship square
+		for (int p = 0; p < sim->players; ++p)
+		{
+			if ((sim->ships_alive & (1u << p)) &&
+				(sim->ship_x[p] < sim->shot_x[i]) && (sim->ship_x[p] + SHIP_SIZE > sim->shot_x[i]) &&
+				(sim->ship_y < sim->shot_y[i]) && (sim->ship_y + SHIP_SIZE > sim->shot_y[i]))
+			{
+				events |= (SHOT_HIT_SHIP << p);
+			}
+		}
+
+		pass->events[i] = events;
+	}
+}
+
+static void NoTransition(SimState* sim, TickContext* tick)
+{
+}
+
+static void ChangeScreen(SimState* sim, TickContext* tick, GameScreen screen);
+
+static void TitleEnter(SimState* sim, TickContext* tick)
+{
+	QueueAudio(tick->audio, AUDIO_FADE_OUT_MUSIC, 100, 0);
+}
+
+static void TitleUpdate(SimState* sim, TickContext* tick)
+{
+	int player = ConfirmPressed(sim, tick);
+
+	if (player >= 0)
+	{
+		tick->reflected |= PlayerActionBit(player, ACTION_CONFIRM);
+		ChangeScreen(sim, tick, GAMEPLAY);
+	}
+}
+
+static void GameplayEnter(SimState* sim, TickContext* tick)
+{
+	sim->ships_alive = (Uint8)((1u << sim->players) - 1);
+	QueueAudio(tick->audio, AUDIO_PLAY_MUSIC, MUSIC_GAMEPLAY, 0);
+}
+
+static void GameplayExit(SimState* sim, TickContext* tick)
+{
+	QueueAudio(tick->audio, AUDIO_FADE_OUT_MUSIC, 100, 0);
+}
+
+static void GameplayUpdate(SimState* sim, TickContext* tick)
+{
+	QueueAudio(tick->audio, AUDIO_BEGIN_TICK, sim->ship_x[0], 0);
+
+	// Update background scroll
+	sim->scroll -= SCROLL_SPEED;
+	if (sim->scroll <= 0) sim->scroll = BACKGROUND_HEIGHT;
+
+	for (int p = 0; p < sim->players; ++p)
+	{
+		Sint16* ship_x = &sim->ship_x[p];
+		KeyState left = tick->left[p];
+		KeyState right = tick->right[p];
+
+		if ((*ship_x >= SHIP_MIN_X) && (*ship_x <= SHIP_MAX_X)) {
+			if (left == KEY_REPEAT) { *ship_x -= SHIP_SPEED; tick->reflected |= PlayerActionBit(p, ACTION_MOVE_LEFT); }
+			else if (right == KEY_REPEAT) { *ship_x += SHIP_SPEED; tick->reflected |= PlayerActionBit(p, ACTION_MOVE_RIGHT); }
+		}
+		else if (*ship_x < SHIP_MIN_X && right == KEY_REPEAT && left == KEY_IDLE) {
+			*ship_x = SHIP_MIN_X;
+			tick->reflected |= PlayerActionBit(p, ACTION_MOVE_RIGHT);
+		}
+		else if (*ship_x > SHIP_MIN_X && left == KEY_REPEAT && right == KEY_IDLE) {
+			*ship_x = SHIP_MAX_X;
+			tick->reflected |= PlayerActionBit(p, ACTION_MOVE_LEFT);
+		}
+	}
+
+	// Waves spawned during the same second leave the same lane free
+	if (sim->tick%SIM_TICK_RATE == 0) sim->wave_gap = NextRandom(&sim->rng)%WAVE_LANES;
+
+	// Update active shots in parallel, each job only writes its own range
+	AsteroidPass pass;
+	pass.sim = sim;
+	ParallelFor(MAX_SHIP_SHOTS, ASTEROID_JOB_CHUNK, UpdateAsteroids, &pass);
+
+	// Asteroids gone are freed before any wave reuses their slot
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i) if (pass.events[i] & SHOT_LEFT_SCREEN) sim->alive &= ~(1u << i);
+
+	// Reduce in asteroid order, so any jobs split gives the same state
+	// NOTE: Waves may overwrite asteroids, keep the hit position before
+	Uint32 hit = 0;					// Players hit
+	int hit_x = 0;
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		Uint32 ships = (pass.events[i]/SHOT_HIT_SHIP) & ~hit;
+
+		if (ships != 0)
+		{
+			if (hit == 0) hit_x = sim->shot_x[i];
+			hit |= ships;
+		}
+
+		if (pass.events[i] & SHOT_REACHED_BOTTOM)
+		{
+			QueueAudio(tick->audio, AUDIO_PLAY_FX, FX_ASTEROID, sim->shot_x[i]);
+			SpawnWave(sim, sim->wave_gap);
+		}
+	}
+
+	// In versus mode the ship left standing wins the round
+	if (hit != 0)
+	{
+		sim->ships_alive &= (Uint8)~hit;
+		QueueAudio(tick->audio, AUDIO_PLAY_FX, FX_EXPLOSION, hit_x);
+		ChangeScreen(sim, tick, ENDING);
+	}
+
+	// L4: DONE 4: Play sound fx_shoot
+	for (int p = 0; p < sim->players; ++p)
+	{
+		if (tick->confirm[p] == KEY_DOWN) QueueAudio(tick->audio, AUDIO_PLAY_FX, FX_SHOOT, sim->ship_x[p]);
+	}
+}
+
+static void EndingEnter(SimState* sim, TickContext* tick)
+{
+	QueueAudio(tick->audio, AUDIO_PLAY_MUSIC, MUSIC_ENDING, 0);
+}
+
+static void EndingUpdate(SimState* sim, TickContext* tick)
+{
+	int player = ConfirmPressed(sim, tick);
+
+	if (player >= 0)
+	{
+		tick->reflected |= PlayerActionBit(player, ACTION_CONFIRM);
+		ChangeScreen(sim, tick, TITLE);
+	}
+}
+
+// Indexed by GameScreen
+static const ScreenRules screens[SCREEN_COUNT] =
+{
+	{ TitleEnter, NoTransition, TitleUpdate },
+	{ GameplayEnter, GameplayExit, GameplayUpdate },
+	{ EndingEnter, NoTransition, EndingUpdate }
+};
+
+static void ChangeScreen(SimState* sim, TickContext* tick, GameScreen screen)
+{
+	screens[sim->screen].exit(sim, tick);
+	sim->screen = (Uint8)screen;
+	screens[screen].enter(sim, tick);
+}
+
+// ----------------------------------------------------------------
+void InitSim(SimState* sim, Uint32 seed, int players)
+{
+	SDL_zerop(sim);
+
+	sim->screen = TITLE;
+	sim->players = (Uint8)SDL_max(1, SDL_min(players, MAX_PLAYERS));
+	sim->ships_alive = (Uint8)((1u << sim->players) - 1);
+
+	// Versus ships start apart, one on each side of the center
+	if (sim->players == 1) sim->ship_x[0] = SCREEN_WIDTH / 2;
+	else for (int p = 0; p < sim->players; ++p) sim->ship_x[p] = (Sint16)(SCREEN_WIDTH / 2 + (2*p - 1)*2*SHIP_SIZE);
+
+	sim->ship_y = (Sint16)(SCREEN_HEIGHT / 1.3);
+	sim->scroll = 0;
+	sim->rng = (seed != 0)? seed : 1;
+
+	// Fill all the asteroids with waves sharing the same gap
+	sim->wave_gap = NextRandom(&sim->rng)%WAVE_LANES;
+	for (int i = 0; i < MAX_SHIP_SHOTS/(WAVE_LANES - 1); ++i) SpawnWave(sim, sim->wave_gap);
+}
+
+// ----------------------------------------------------------------
+Uint32 HashSim(const SimState* sim)
+{
+	// NOTE: Fields are hashed in memory order, this assumes a little endian platform
+	return HashBytes(sim, offsetof(SimState, shot_y) + sizeof(sim->shot_y), SIM_STATE_VERSION);
+}
+
+// ----------------------------------------------------------------
+int PrintSimDiff(const SimState* sim, const SimState* expected)
+{
+	int differences = 0;
+
+#define CHECK_FIELD(field) if (sim->field != expected->field) { printf("  %-12s %lld, expected %lld\n", #field, (long long)sim->field, (long long)expected->field); differences++; }
+	CHECK_FIELD(tick);
+	CHECK_FIELD(rng);
+	CHECK_FIELD(alive);
+	CHECK_FIELD(ship_x[0]);
+	CHECK_FIELD(ship_x[1]);
+	CHECK_FIELD(ship_y);
+	CHECK_FIELD(scroll);
+	CHECK_FIELD(screen);
+	CHECK_FIELD(actions);
+	CHECK_FIELD(last_shot);
+	CHECK_FIELD(wave_gap);
+	CHECK_FIELD(players);
+	CHECK_FIELD(ships_alive);
+#undef CHECK_FIELD
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((sim->shot_x[i] != expected->shot_x[i]) || (sim->shot_y[i] != expected->shot_y[i]))
+		{
+			printf("  shot[%i]      %i,%i, expected %i,%i\n", i, sim->shot_x[i], sim->shot_y[i], expected->shot_x[i], expected->shot_y[i]);
+			differences++;
+		}
+	}
+
+	return differences;
+}
+
+// ----------------------------------------------------------------
+Uint32 MoveStuff(SimState* sim, Uint32 actions, AudioCommandList* audio)
+{
+	TickContext tick;
+
+	// Player actions are read as player 1 ones, each from its own bits
+	for (int p = 0; p < MAX_PLAYERS; ++p)
+	{
+		Uint32 held = actions >> (p*PLAYER_ACTION_BITS);
+		Uint32 prev_held = sim->actions >> (p*PLAYER_ACTION_BITS);
+
+		tick.left[p] = GetActionState(held, prev_held, ACTION_MOVE_LEFT);
+		tick.right[p] = GetActionState(held, prev_held, ACTION_MOVE_RIGHT);
+		tick.confirm[p] = GetActionState(held, prev_held, ACTION_CONFIRM);
+	}
+
+	tick.reflected = 0;
+	tick.audio = audio;
+
+	sim->actions = (Uint8)actions;
+
+	// NOTE: A screen change takes effect next tick, update never runs twice
+	screens[sim->screen].update(sim, &tick);
+
+	sim->tick++;
+
+	return tick.reflected;
+}
@@ -0,0 +1,136 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Game - Simulation state and rules
+//
+// Everything a simulation tick reads and writes lives in SimState: a
+// small, trivially copyable struct kept apart from window, textures and
+// audio handles. A tick only needs the state and the actions held, so
+// the simulation can be copied with a memcpy and stepped anywhere.
+// -------------------------------------------------------------------------
+
+#ifndef __GAME_H__
+#define __GAME_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include <type_traits>				// Required for: std::is_trivially_copyable
+
+#define SCREEN_WIDTH		901
+#define SCREEN_HEIGHT		901
+
+#define BACKGROUND_WIDTH	 901		// Assets/Definitivisimo.png size, scroll wraps at its height
+#define BACKGROUND_HEIGHT	2616
+
+#define SHIP_SPEED			   8
+#define SHIP_SIZE			  64
+#define SHIP_MIN_X			 155		// Ship moves between these, snapping back in when pushed out
+#define SHIP_MAX_X			 680
+#define MAX_SHIP_SHOTS		 32		// Asteroids, one bit each in SimState::alive
+#define SHOT_SPEED			  12
+#define SHOT_DRAW_WIDTH		  86		// Asteroid sprite size on screen
+#define SHOT_DRAW_HEIGHT	 124
+#define SCROLL_SPEED		  19
+
+#define SIM_TICK_RATE		  60		// Simulation ticks per second
+#define SIM_STATE_VERSION	   2		// Bump on any SimState layout or rules change
+
+#define MAX_AUDIO_COMMANDS	 256
+
+#define MAX_PLAYERS			   2		// Versus mode ships, actions of player p are shifted p*PLAYER_ACTION_BITS
+
+#define WAVE_LANES			   5		// Asteroid lanes, a wave leaves one of them free
+#define WAVE_FIRST_LANE_X	 166
+#define WAVE_LANE_WIDTH		 120
+#define ASTEROID_JOB_CHUNK	   8		// Asteroids updated per job
+
+enum GameScreen
+{
+	TITLE = 0,
+	GAMEPLAY,
+	ENDING,
+	SCREEN_COUNT
+};
+
+enum GameMusic
+{
+	MUSIC_GAMEPLAY = 0,
+	MUSIC_ENDING
+};
+
+enum AudioCommandType
+{
+	AUDIO_BEGIN_TICK = 0,		// value: listener x
+	AUDIO_PLAY_FX,				// value: SoundFx, x: sound position
+	AUDIO_PLAY_MUSIC,			// value: GameMusic
+	AUDIO_FADE_OUT_MUSIC		// value: fade milliseconds
+};
+
+struct AudioCommand
+{
+	AudioCommandType type;
+	int value;
+	int x;
+};
+
+// Audio requested by the simulation, the simulation never calls SDL_mixer itself
+struct AudioCommandList
+{
+	int count;
+	int dropped;
+	AudioCommand commands[MAX_AUDIO_COMMANDS];
+};
+
+// Per tick game state, hot fields first
+// NOTE: No pointers, copying it is all a snapshot needs
+struct alignas(64) SimState
+{
+	Uint32 tick;
+	Uint32 rng;						// Random generator state (xorshift32)
+	Uint32 alive;					// Live asteroids, one bit each
+	Sint16 ship_x[MAX_PLAYERS];
+	Sint16 ship_y;					// Shared, ships only move sideways
+	Sint16 scroll;
+	Uint8 screen;					// GameScreen
+	Uint8 actions;					// Actions held last tick, for KEY_DOWN/KEY_UP edges
+	Uint8 last_shot;				// Next asteroid a wave overwrites
+	Uint8 wave_gap;					// Free lane of the waves spawned this second
+	Uint8 players;
+	Uint8 ships_alive;				// One bit per player, a round ends on the first ship hit
+
+	Sint16 shot_x[MAX_SHIP_SHOTS];
+	Sint16 shot_y[MAX_SHIP_SHOTS];
+};
+
+static_assert(std::is_trivially_copyable<SimState>::value, "SimState must be copyable with memcpy");
+static_assert(sizeof(SimState) <= 192, "SimState should fit in three cache lines");
+
+// Title screen state, the seed picks the asteroid waves
+// NOTE: Seed 0 would stick the generator at 0, 1 is used instead
+void InitSim(SimState* sim, Uint32 seed, int players);
+
+// Step a deterministic xorshift32 random stream, returns its new state
+// NOTE: Lanes and bots must draw exactly as the rules do, every stream uses this one
+inline Uint32 NextRandom(Uint32* state)
+{
+	Uint32 x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return (*state = x);
+}
+
+// Hash of every SimState field (padding excluded), the same on any platform
+Uint32 HashSim(const SimState* sim);
+
+// Print the fields of sim different from expected, returns how many differ
+int PrintSimDiff(const SimState* sim, const SimState* expected);
+
+// Advance one tick with the actions held (ACTION_BIT() mask, player 2 ones included), audio may be NULL
+// Every screen has its rules table entry: update runs every tick, enter
+// and exit only on screen changes (music changes...)
+// Returns the actions that visibly changed the game this tick
+Uint32 MoveStuff(SimState* sim, Uint32 actions, AudioCommandList* audio);
+
+#endif // __GAME_H__
@@ -0,0 +1,98 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Golden - Rendered frames compared against reference images
+// -------------------------------------------------------------------------
+
+#include "Golden.h"
+
+#include <stdio.h>			// Required for: printf()
+
+static inline int ChannelDelta(Uint32 a, Uint32 b, int shift)
+{
+	return SDL_abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+}
+
+// ----------------------------------------------------------------
+SDL_Surface* CreateGoldenSurface(int width, int height)
+{
+	SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, GOLDEN_FORMAT);
+
+	if (frame == NULL) printf("WARNING: Unable to create a %ix%i frame surface! SDL Error: %s\n", width, height, SDL_GetError());
+
+	return frame;
+}
+
+// ----------------------------------------------------------------
+bool ReadGoldenFrame(SDL_Renderer* renderer, SDL_Surface* frame)
+{
+	if (SDL_RenderReadPixels(renderer, NULL, GOLDEN_FORMAT, frame->pixels, frame->pitch) != 0)
+	{
+		printf("WARNING: Unable to read rendered pixels! SDL Error: %s\n", SDL_GetError());
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void GetGoldenPath(char* path, const char* dir, Uint32 tick, const char* suffix)
+{
+	SDL_snprintf(path, GOLDEN_PATH_SIZE, "%s/tick_%06u%s.bmp", dir, tick, suffix);
+}
+
+// ----------------------------------------------------------------
+SDL_Surface* LoadGolden(const char* path)
+{
+	SDL_Surface* loaded = SDL_LoadBMP(path);
+	if (loaded == NULL) return NULL;
+
+	SDL_Surface* golden = SDL_ConvertSurfaceFormat(loaded, GOLDEN_FORMAT, 0);
+	SDL_FreeSurface(loaded);
+
+	return golden;
+}
+
+// ----------------------------------------------------------------
+bool SaveGolden(const SDL_Surface* frame, const char* path)
+{
+	if (SDL_SaveBMP((SDL_Surface*)frame, path) != 0)
+	{
+		printf("WARNING: Unable to save %s! SDL Error: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+GoldenDiff CompareGolden(const SDL_Surface* frame, const SDL_Surface* golden, int tolerance, SDL_Surface* diff)
+{
+	GoldenDiff result = { frame->w*frame->h, 0, 0 };
+
+	if ((golden->w != frame->w) || (golden->h != frame->h))
+	{
+		result.differing = result.pixels;
+		result.max_delta = 255;
+		return result;
+	}
+
+	for (int y = 0; y < frame->h; ++y)
+	{
+		const Uint32* a = (const Uint32*)((const Uint8*)frame->pixels + y*frame->pitch);
+		const Uint32* b = (const Uint32*)((const Uint8*)golden->pixels + y*golden->pitch);
+		Uint32* out = (diff != NULL)? (Uint32*)((Uint8*)diff->pixels + y*diff->pitch) : NULL;
+
+		for (int x = 0; x < frame->w; ++x)
+		{
+			// ARGB8888, alpha is not compared: every frame is opaque
+			int delta = SDL_max(ChannelDelta(a[x], b[x], 16), SDL_max(ChannelDelta(a[x], b[x], 8), ChannelDelta(a[x], b[x], 0)));
+
+			if (delta > result.max_delta) result.max_delta = delta;
+			if (delta > tolerance) result.differing++;
+
+			if (out != NULL) out[x] = (delta > tolerance)? 0xFFFF0000 : (0xFF000000 | ((b[x] >> 2) & 0x3F3F3F));
+		}
+	}
+
+	return result;
+}
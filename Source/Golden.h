@@ -0,0 +1,43 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Golden - Rendered frames compared against reference images
+//
+// Frames are read back from the renderer into GOLDEN_FORMAT surfaces and
+// compared pixel by pixel with the golden images of the same ticks, BMP
+// files named after the tick. A pixel differs when any channel is off by
+// more than the tolerance; differing pixels are painted on a diff image
+// saved next to the golden one, to see at a glance what moved.
+// -------------------------------------------------------------------------
+
+#ifndef __GOLDEN_H__
+#define __GOLDEN_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define GOLDEN_FORMAT		SDL_PIXELFORMAT_ARGB8888
+#define GOLDEN_PATH_SIZE	 512
+
+struct GoldenDiff
+{
+	int pixels;					// Compared
+	int differing;				// Over tolerance, all of them if sizes differ
+	int max_delta;				// Largest channel difference
+};
+
+// Surface frames are read into, width x height
+SDL_Surface* CreateGoldenSurface(int width, int height);
+
+// Copy what renderer drew to its current target into frame
+bool ReadGoldenFrame(SDL_Renderer* renderer, SDL_Surface* frame);
+
+// Golden image path of tick in dir, suffix before the extension ("" or ".diff")
+void GetGoldenPath(char* path, const char* dir, Uint32 tick, const char* suffix);
+
+// Golden image converted to GOLDEN_FORMAT, NULL if missing
+SDL_Surface* LoadGolden(const char* path);
+bool SaveGolden(const SDL_Surface* frame, const char* path);
+
+// Compare frame against golden, diff (may be NULL, frame sized) gets the golden darkened and differing pixels in red
+GoldenDiff CompareGolden(const SDL_Surface* frame, const SDL_Surface* golden, int tolerance, SDL_Surface* diff);
+
+#endif // __GOLDEN_H__
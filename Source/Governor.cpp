@@ -0,0 +1,119 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Governor - Dynamic resolution and effects quality
+// -------------------------------------------------------------------------
+
+#include "Governor.h"
+
+#define GOVERNOR_STEPS		(8 - GOVERNOR_MIN_EIGHTHS + GOVERNOR_EFFECTS)
+
+static bool enabled = false;
+static Uint64 budget = 0;			// Counter ticks
+static int step = 0;				// Quality steps down, 0 is full quality
+static bool probing = false;		// Last decision was a step up
+
+static Uint64 last_present = 0;
+static Uint64 window_time = 0;
+static int window_frames = 0;
+static int windows_on_budget = 0;
+static int raise_windows = GOVERNOR_RAISE_WINDOWS;
+
+static GovernorStats stats;
+static Uint64 eighths_total = 0;
+
+// ----------------------------------------------------------------
+void InitGovernor(bool enable, double budget_ms)
+{
+	enabled = enable && (budget_ms > 0.0);
+	budget = (Uint64)(budget_ms*SDL_GetPerformanceFrequency()/1000.0);
+	step = 0;
+	probing = false;
+
+	last_present = 0;
+	window_time = 0;
+	window_frames = 0;
+	windows_on_budget = 0;
+	raise_windows = GOVERNOR_RAISE_WINDOWS;
+
+	SDL_zero(stats);
+	stats.min_scale = 1.0f;
+	eighths_total = 0;
+}
+
+// ----------------------------------------------------------------
+void UpdateGovernor(Uint64 presented)
+{
+	stats.frames++;
+	eighths_total += GetGovernorEighths();
+	stats.min_scale = SDL_min(stats.min_scale, GetGovernorEighths()/8.0f);
+
+	Uint64 interval = (last_present > 0)? presented - last_present : 0;
+	last_present = presented;
+
+	if (!enabled || (interval == 0)) return;
+
+	window_time += interval;
+	if (++window_frames < GOVERNOR_WINDOW) return;
+
+	Uint64 average = window_time/window_frames;
+	window_time = 0;
+	window_frames = 0;
+
+	if (average > (Uint64)(budget*GOVERNOR_OVER))
+	{
+		// Stepped up too early, wait longer before trying again
+		if (probing)
+		{
+			stats.failed_raises++;
+			raise_windows = SDL_min(raise_windows*2, GOVERNOR_MAX_WINDOWS);
+		}
+
+		if (step < GOVERNOR_STEPS)
+		{
+			step++;
+			stats.lowered++;
+		}
+
+		windows_on_budget = 0;
+		probing = false;
+	}
+	else if (average <= (Uint64)(budget*GOVERNOR_ON_BUDGET))
+	{
+		if (probing) raise_windows = GOVERNOR_RAISE_WINDOWS;
+		probing = false;
+
+		if ((++windows_on_budget >= raise_windows) && (step > 0))
+		{
+			step--;
+			stats.raised++;
+			windows_on_budget = 0;
+			probing = true;
+		}
+	}
+	else
+	{
+		windows_on_budget = 0;
+		probing = false;
+	}
+}
+
+// ----------------------------------------------------------------
+int GetGovernorEighths()
+{
+	return 8 - SDL_min(step, 8 - GOVERNOR_MIN_EIGHTHS);
+}
+
+// ----------------------------------------------------------------
+int GetGovernorEffects()
+{
+	return GOVERNOR_EFFECTS - SDL_max(step - (8 - GOVERNOR_MIN_EIGHTHS), 0);
+}
+
+// ----------------------------------------------------------------
+GovernorStats GetGovernorStats()
+{
+	GovernorStats result = stats;
+	result.avg_scale = (stats.frames > 0)? (float)eighths_total/(8.0f*stats.frames) : 1.0f;
+
+	return result;
+}
@@ -0,0 +1,54 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Governor - Dynamic resolution and effects quality
+//
+// Frames are drawn into an internal target at a scale of the screen, then
+// upscaled to the window. The governor watches the presented frames
+// interval over windows of GOVERNOR_WINDOW frames: over budget it takes a
+// quality step down, back on budget for long enough it tries a step up.
+//
+// Steps go down the resolution first, one eighth of the screen side at a
+// time down to GOVERNOR_MIN_EIGHTHS, then the optional effects budget down
+// to 0. A step up that misses the budget right away was too early: the
+// wait before the next try doubles, so quality does not flicker between
+// two steps on a machine that only holds the lower one.
+// -------------------------------------------------------------------------
+
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define GOVERNOR_MIN_EIGHTHS	   4		// Lowest scale, 4/8 of the screen side
+#define GOVERNOR_EFFECTS		   1		// Optional effects levels, 0 draws none of them
+#define GOVERNOR_WINDOW			  30		// Frames averaged per decision
+#define GOVERNOR_OVER			1.10		// Average interval over budget lowering quality
+#define GOVERNOR_ON_BUDGET		1.02		// Average interval still on budget
+#define GOVERNOR_RAISE_WINDOWS	   4		// Windows on budget before a step up
+#define GOVERNOR_MAX_WINDOWS	  64		// Longest wait before a step up, after failed ones
+
+struct GovernorStats
+{
+	int frames;
+	int lowered;				// Steps down
+	int raised;					// Steps up
+	int failed_raises;			// Steps up undone by the next window
+	float avg_scale;			// Screen side fraction drawn, per frame
+	float min_scale;
+};
+
+// budget_ms: presented frames interval to hold, enabled false keeps full quality
+void InitGovernor(bool enabled, double budget_ms);
+
+// Main thread, once per frame: time SDL_RenderPresent() returned
+void UpdateGovernor(Uint64 presented);
+
+// Screen side drawn, in eighths, GOVERNOR_MIN_EIGHTHS to 8
+int GetGovernorEighths();
+
+// Optional effects budget, 0 to GOVERNOR_EFFECTS
+int GetGovernorEffects();
+
+GovernorStats GetGovernorStats();
+
+#endif // __GOVERNOR_H__
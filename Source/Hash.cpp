@@ -0,0 +1,73 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Hash - Fast non cryptographic hash (xxHash32)
+// -------------------------------------------------------------------------
+
+#include "Hash.h"
+
+#define PRIME32_1	0x9E3779B1u
+#define PRIME32_2	0x85EBCA77u
+#define PRIME32_3	0xC2B2AE3Du
+#define PRIME32_4	0x27D4EB2Fu
+#define PRIME32_5	0x165667B1u
+
+static Uint32 RotateLeft(Uint32 x, int bits)
+{
+	return (x << bits) | (x >> (32 - bits));
+}
+
+static Uint32 ReadLE32(const Uint8* data)
+{
+	Uint32 value;
+	SDL_memcpy(&value, data, 4);
+	return SDL_SwapLE32(value);
+}
+
+static Uint32 Round(Uint32 accumulator, Uint32 input)
+{
+	accumulator += input*PRIME32_2;
+	accumulator = RotateLeft(accumulator, 13);
+	return accumulator*PRIME32_1;
+}
+
+// ----------------------------------------------------------------
+Uint32 HashBytes(const void* data, size_t size, Uint32 seed)
+{
+	const Uint8* bytes = (const Uint8*)data;
+	const Uint8* end = bytes + size;
+	Uint32 hash;
+
+	if (size >= 16)
+	{
+		// Four independent lanes, 16 bytes per step
+		Uint32 v1 = seed + PRIME32_1 + PRIME32_2;
+		Uint32 v2 = seed + PRIME32_2;
+		Uint32 v3 = seed;
+		Uint32 v4 = seed - PRIME32_1;
+
+		for (; bytes + 16 <= end; bytes += 16)
+		{
+			v1 = Round(v1, ReadLE32(bytes));
+			v2 = Round(v2, ReadLE32(bytes + 4));
+			v3 = Round(v3, ReadLE32(bytes + 8));
+			v4 = Round(v4, ReadLE32(bytes + 12));
+		}
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+	}
+	else hash = seed + PRIME32_5;
+
+	hash += (Uint32)size;
+
+	for (; bytes + 4 <= end; bytes += 4) hash = RotateLeft(hash + ReadLE32(bytes)*PRIME32_3, 17)*PRIME32_4;
+	for (; bytes < end; ++bytes) hash = RotateLeft(hash + (*bytes)*PRIME32_5, 11)*PRIME32_1;
+
+	// Avalanche
+	hash ^= hash >> 15;
+	hash *= PRIME32_2;
+	hash ^= hash >> 13;
+	hash *= PRIME32_3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
@@ -0,0 +1,16 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Hash - Fast non cryptographic hash (xxHash32)
+//
+// Same result on every platform and compiler, used to compare simulation
+// states across runs, builds and thread counts.
+// -------------------------------------------------------------------------
+
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+Uint32 HashBytes(const void* data, size_t size, Uint32 seed);
+
+#endif // __HASH_H__
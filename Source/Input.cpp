@@ -0,0 +1,366 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Input - Packed keyboard state, action map and timestamped events queue
+//
+// The main thread keeps the keyboard as bitsets: SDL_GetKeyboardState()
+// bytes are compared against the previous frame 16/32 at a time and the
+// action map is only looked up when something changed.
+//
+// An SDL event watch runs the moment SDL receives an event from the OS,
+// inside the pump, so key edges are timestamped there, translated to
+// actions and pushed into a lock-free queue. The simulation drains it once
+// per tick with its own action states, instead of sampling whatever the
+// keyboard looks like when the frame starts, so no short press is lost.
+// Keys injected by the simulation thread itself (bots) go through their
+// own queue, merged with the pumped one in time order.
+// -------------------------------------------------------------------------
+
+#include "Input.h"
+#include "Queue.h"
+#include "Latency.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#if defined(__AVX2__)
+#include <immintrin.h>		// Required for: AVX2 intrinsics (SSE2 ones come with SDL_cpuinfo.h)
+#endif
+
+struct ActionBinding
+{
+	SDL_Scancode keys[MAX_ACTION_KEYS];
+	int count;
+};
+
+static ActionBinding bindings[ACTION_COUNT];
+static Uint8 action_map[SDL_NUM_SCANCODES];		// Compiled bindings: scancode -> action bits
+
+// Main thread keyboard state
+static Uint8 prev_keys[SDL_NUM_SCANCODES];
+static Uint32 keys_down[KEYBOARD_WORDS];
+static Uint32 keys_pressed[KEYBOARD_WORDS];
+static Uint32 keys_released[KEYBOARD_WORDS];
+static Uint32 frame_held = 0;
+static Uint32 frame_prev_held = 0;
+
+// Simulation side state
+static SpscQueue<InputEvent, INPUT_QUEUE_SIZE> events;		// Pump thread -> simulation
+static SpscQueue<InputEvent, INPUT_QUEUE_SIZE> injected;	// Simulation -> simulation
+static int action_keys[ACTION_COUNT];			// Bound keys currently held, per action
+static Uint32 tick_held = 0;
+static Uint32 tick_prev_held = 0;
+
+static SDL_atomic_t dropped;
+static InputStats stats;
+static Uint64 total_delay = 0;
+static Uint64 max_delay = 0;
+
+static int LowestBit(Uint32 bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+static void CompileActionMap()
+{
+	SDL_zeroa(action_map);
+
+	for (int a = 0; a < ACTION_COUNT; ++a)
+	{
+		for (int k = 0; k < bindings[a].count; ++k) action_map[bindings[a].keys[k]] |= ACTION_BIT(a);
+	}
+}
+
+// Actions bound to any key set in the bitset
+static Uint32 ActionsOf(const Uint32* bits)
+{
+	Uint32 actions = 0;
+
+	for (int w = 0; w < KEYBOARD_WORDS; ++w)
+	{
+		for (Uint32 word = bits[w]; word != 0; word &= word - 1) actions |= action_map[w*32 + LowestBit(word)];
+	}
+
+	return actions;
+}
+
+// ----------------------------------------------------------------
+KeyState GetActionState(Uint32 held, Uint32 prev_held, Action action)
+{
+	Uint32 bit = ACTION_BIT(action);
+
+	if (held & bit) return (prev_held & bit)? KEY_REPEAT : KEY_DOWN;
+	return (prev_held & bit)? KEY_UP : KEY_IDLE;
+}
+
+// Compare 32 keyboard bytes (0 or 1 each) against the previous ones,
+// one bit per key for keys down and keys that changed
+static void DiffKeyboardWord(const Uint8* keys, const Uint8* prev, Uint32* down, Uint32* changed)
+{
+#if defined(__AVX2__)
+	__m256i cur = _mm256_loadu_si256((const __m256i*)keys);
+
+	*down = ~(Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, _mm256_setzero_si256()));
+	*changed = ~(Uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, _mm256_loadu_si256((const __m256i*)prev)));
+#elif defined(__SSE2__)
+	__m128i lo = _mm_loadu_si128((const __m128i*)keys);
+	__m128i hi = _mm_loadu_si128((const __m128i*)(keys + 16));
+	__m128i zero = _mm_setzero_si128();
+
+	*down = ~((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, zero)) | ((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, zero)) << 16));
+	*changed = ~((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, _mm_loadu_si128((const __m128i*)prev))) |
+		((Uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, _mm_loadu_si128((const __m128i*)(prev + 16)))) << 16));
+#else
+	*down = 0;
+	*changed = 0;
+
+	for (int i = 0; i < 32; ++i)
+	{
+		if (keys[i] != 0) *down |= (1u << i);
+		if (keys[i] != prev[i]) *changed |= (1u << i);
+	}
+#endif
+}
+
+// Queue holding the earliest edge received before time, NULL if none
+static SpscQueue<InputEvent, INPUT_QUEUE_SIZE>* EarliestQueue(Uint64 time, InputEvent* input)
+{
+	InputEvent pumped, bot;
+	bool has_pumped = events.Peek(&pumped) && (pumped.time <= time);
+	bool has_bot = injected.Peek(&bot) && (bot.time <= time);
+
+	if (has_pumped && (!has_bot || (pumped.time <= bot.time)))
+	{
+		*input = pumped;
+		return &events;
+	}
+
+	if (has_bot)
+	{
+		*input = bot;
+		return &injected;
+	}
+
+	return NULL;
+}
+
+// WARNING: Called from the thread pumping events
+static int SDLCALL QueueKeyEvent(void* userdata, SDL_Event* event)
+{
+	if (((event->type == SDL_KEYDOWN) && (event->key.repeat == 0)) || (event->type == SDL_KEYUP))
+	{
+		int scancode = (int)event->key.keysym.scancode;
+
+		// Keys not bound to any action are of no interest to the simulation
+		if ((scancode >= SDL_NUM_SCANCODES) || (action_map[scancode] == 0)) return 1;
+
+		InputEvent input;
+		input.time = SDL_GetPerformanceCounter();
+		input.scancode = (Uint16)scancode;
+		input.actions = action_map[scancode];
+		input.down = (event->type == SDL_KEYDOWN)? 1 : 0;
+
+		if (!events.Push(input)) SDL_AtomicAdd(&dropped, 1);
+	}
+
+	return 1;
+}
+
+// ----------------------------------------------------------------
+void InitInput()
+{
+	events.Clear();
+	injected.Clear();
+	SDL_zeroa(prev_keys);
+	SDL_zeroa(keys_down);
+	SDL_zeroa(keys_pressed);
+	SDL_zeroa(keys_released);
+	SDL_zeroa(action_keys);
+	SDL_zero(stats);
+	SDL_AtomicSet(&dropped, 0);
+	frame_held = frame_prev_held = 0;
+	tick_held = tick_prev_held = 0;
+	total_delay = 0;
+	max_delay = 0;
+
+	// Default bindings
+	SDL_zeroa(bindings);
+	BindAction(ACTION_MOVE_LEFT, SDL_SCANCODE_LEFT);
+	BindAction(ACTION_MOVE_RIGHT, SDL_SCANCODE_RIGHT);
+	BindAction(ACTION_CONFIRM, SDL_SCANCODE_RETURN);
+	BindAction(ACTION_QUIT, SDL_SCANCODE_ESCAPE);
+	BindAction(ACTION_P2_MOVE_LEFT, SDL_SCANCODE_A);
+	BindAction(ACTION_P2_MOVE_RIGHT, SDL_SCANCODE_D);
+	BindAction(ACTION_P2_CONFIRM, SDL_SCANCODE_SPACE);
+
+	SDL_AddEventWatch(QueueKeyEvent, NULL);
+}
+
+// ----------------------------------------------------------------
+void CloseInput()
+{
+	SDL_DelEventWatch(QueueKeyEvent, NULL);
+}
+
+// ----------------------------------------------------------------
+void BindAction(Action action, SDL_Scancode scancode)
+{
+	ActionBinding* binding = &bindings[action];
+
+	for (int k = 0; k < binding->count; ++k) if (binding->keys[k] == scancode) return;
+
+	if (binding->count < MAX_ACTION_KEYS) binding->keys[binding->count++] = scancode;
+	else printf("WARNING: Too many keys bound to action %i\n", (int)action);
+
+	CompileActionMap();
+}
+
+// ----------------------------------------------------------------
+void ClearActionBindings(Action action)
+{
+	bindings[action].count = 0;
+	CompileActionMap();
+}
+
+// ----------------------------------------------------------------
+SDL_Scancode GetActionKey(Action action)
+{
+	return (bindings[action].count > 0)? bindings[action].keys[0] : SDL_SCANCODE_UNKNOWN;
+}
+
+// ----------------------------------------------------------------
+void InjectKey(SDL_Scancode scancode, bool down, Uint64 time)
+{
+	if ((scancode <= SDL_SCANCODE_UNKNOWN) || (scancode >= SDL_NUM_SCANCODES) || (action_map[scancode] == 0)) return;
+
+	InputEvent input;
+	input.time = time;
+	input.scancode = (Uint16)scancode;
+	input.actions = action_map[scancode];
+	input.down = down? 1 : 0;
+
+	if (!injected.Push(input)) SDL_AtomicAdd(&dropped, 1);
+}
+
+// ----------------------------------------------------------------
+void PumpInput()
+{
+	SDL_PumpEvents();
+}
+
+// ----------------------------------------------------------------
+void UpdateKeyboard()
+{
+	const Uint8* keys = SDL_GetKeyboardState(NULL);
+	Uint32 any_change = 0;
+
+	for (int w = 0; w < KEYBOARD_WORDS; ++w)
+	{
+		Uint32 down, changed;
+		DiffKeyboardWord(keys + w*32, prev_keys + w*32, &down, &changed);
+
+		keys_pressed[w] = changed & down;
+		keys_released[w] = changed & ~down;
+		keys_down[w] = down;
+		any_change |= changed;
+	}
+
+	frame_prev_held = frame_held;
+
+	// Most frames nothing changed: skip the action lookups
+	if (any_change != 0)
+	{
+		frame_held = ActionsOf(keys_down);
+		SDL_memcpy(prev_keys, keys, SDL_NUM_SCANCODES);
+	}
+}
+
+// ----------------------------------------------------------------
+KeyState GetFrameAction(Action action)
+{
+	return GetActionState(frame_held, frame_prev_held, action);
+}
+
+// ----------------------------------------------------------------
+KeyState GetFrameKey(SDL_Scancode scancode)
+{
+	Uint32 bit = 1u << (scancode & 31);
+	int w = scancode >> 5;
+
+	if (keys_pressed[w] & bit) return KEY_DOWN;
+	if (keys_released[w] & bit) return KEY_UP;
+	return (keys_down[w] & bit)? KEY_REPEAT : KEY_IDLE;
+}
+
+// ----------------------------------------------------------------
+void UpdateInputTick(Uint64 time)
+{
+	Uint32 changed = 0;			// Actions that already had an edge this tick
+	SpscQueue<InputEvent, INPUT_QUEUE_SIZE>* queue = NULL;
+	InputEvent input;
+
+	tick_prev_held = tick_held;
+
+	while ((queue = EarliestQueue(time, &input)) != NULL)
+	{
+		// Second edge of the same action in this tick: leave it for the next one
+		if (input.actions & changed)
+		{
+			stats.deferred++;
+			break;
+		}
+
+		queue->Pop(&input);
+
+		for (int a = 0; a < ACTION_COUNT; ++a)
+		{
+			Uint32 bit = ACTION_BIT(a);
+			if ((input.actions & bit) == 0) continue;
+
+			if (input.down) action_keys[a]++;
+			else if (action_keys[a] > 0) action_keys[a]--;
+
+			// NOTE: Another key bound to the same action may keep it held
+			if (((tick_held & bit) != 0) != (action_keys[a] > 0))
+			{
+				tick_held ^= bit;
+				changed |= bit;
+				TagInputEdge(a, input.time);
+			}
+		}
+
+		Uint64 delay = time - input.time;
+		total_delay += delay;
+		if (delay > max_delay) max_delay = delay;
+		stats.events++;
+	}
+}
+
+// ----------------------------------------------------------------
+KeyState GetTickAction(Action action)
+{
+	return GetActionState(tick_held, tick_prev_held, action);
+}
+
+// ----------------------------------------------------------------
+Uint32 GetTickActions()
+{
+	return tick_held;
+}
+
+// ----------------------------------------------------------------
+InputStats GetInputStats()
+{
+	InputStats result = stats;
+	double ms = 1000.0/SDL_GetPerformanceFrequency();
+
+	result.dropped = SDL_AtomicGet(&dropped);
+	result.avg_delay_ms = (stats.events > 0)? (float)(total_delay*ms/stats.events) : 0.0f;
+	result.max_delay_ms = (float)(max_delay*ms);
+
+	return result;
+}
@@ -0,0 +1,102 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Input - Packed keyboard state, action map and timestamped events queue
+//
+// SDL API: http://wiki.libsdl.org/APIByCategory
+// -------------------------------------------------------------------------
+
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define KEYBOARD_WORDS		(SDL_NUM_SCANCODES/32)		// One bit per scancode
+#define INPUT_QUEUE_SIZE	 256		// Must be a power of two
+#define MAX_ACTION_KEYS		   4		// Keys that can be bound to the same action
+
+#define ACTION_BIT(a)		(1u << (a))
+#define PLAYER_ACTION_BITS	   4		// Player 2 actions are player 1 ones shifted this many bits
+
+enum KeyState
+{
+	KEY_IDLE = 0,		// DEFAULT
+	KEY_DOWN,			// PRESSED (DEFAULT->DOWN)
+	KEY_REPEAT,			// KEEP DOWN (sustained)
+	KEY_UP				// RELEASED (DOWN->DEFAULT)
+};
+
+// Gameplay never reads scancodes, only actions
+// NOTE: Up to 8 actions, a scancode maps to a bitmask of them,
+// so one byte carries the actions of both players
+enum Action
+{
+	ACTION_MOVE_LEFT = 0,
+	ACTION_MOVE_RIGHT,
+	ACTION_CONFIRM,
+	ACTION_QUIT,
+	ACTION_P2_MOVE_LEFT = ACTION_MOVE_LEFT + PLAYER_ACTION_BITS,
+	ACTION_P2_MOVE_RIGHT,
+	ACTION_P2_CONFIRM,
+	ACTION_COUNT
+};
+
+struct InputEvent
+{
+	Uint64 time;		// SDL_GetPerformanceCounter() when SDL received the event
+	Uint16 scancode;
+	Uint8 actions;		// Actions bound to the scancode when the event was queued
+	Uint8 down;			// 1 pressed, 0 released
+};
+
+struct InputStats
+{
+	int events;			// Action edges applied to the simulation
+	int dropped;		// Lost because the queue was full
+	int deferred;		// Edges moved to the next tick to keep short taps visible
+	float avg_delay_ms;	// Time from SDL receiving an edge to the tick applying it
+	float max_delay_ms;
+};
+
+// Register the event watch that timestamps and queues key edges,
+// and bind the default keys to every action
+// NOTE: Edges are queued whenever SDL pumps events (SDL_PollEvent(), SDL_PumpEvents()...)
+void InitInput();
+void CloseInput();
+
+// Action map, compiled into a scancode -> actions lookup table
+void BindAction(Action action, SDL_Scancode scancode);
+void ClearActionBindings(Action action);
+// First key bound to action, SDL_SCANCODE_UNKNOWN if none
+SDL_Scancode GetActionKey(Action action);
+
+// Simulation thread: queue a key edge as if SDL received it at time, bots press keys through it
+// NOTE: Edges must be injected in time order, they are merged with the pumped ones
+void InjectKey(SDL_Scancode scancode, bool down, Uint64 time);
+
+// Pump pending OS events so they get queued with an accurate timestamp
+// WARNING: SDL only allows it from the thread that created the window
+void PumpInput();
+
+// Main thread, once per frame: diff SDL_GetKeyboardState() against the
+// previous frame into packed pressed/released bitsets
+void UpdateKeyboard();
+KeyState GetFrameAction(Action action);
+// Raw key state, for keys not worth an action (debug toggles...)
+KeyState GetFrameKey(SDL_Scancode scancode);
+
+// Consumer side, once per simulation tick: apply queued edges received
+// before time. An action changes at most once per tick, so a press and
+// release inside one tick are seen as KEY_DOWN this tick and KEY_UP the next
+void UpdateInputTick(Uint64 time);
+
+// Action state for the current simulation tick
+KeyState GetTickAction(Action action);
+// Actions held this tick, one ACTION_BIT() each
+Uint32 GetTickActions();
+
+// Action state from the actions held this time and the previous one
+KeyState GetActionState(Uint32 held, Uint32 prev_held, Action action);
+
+InputStats GetInputStats();
+
+#endif // __INPUT_H__
@@ -0,0 +1,256 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Jobs - Work-stealing job system
+// -------------------------------------------------------------------------
+
+#include "Jobs.h"
+
+#include <stdio.h>			// Required for: printf()
+
+struct Job
+{
+	JobFunction function;
+	void* data;
+	int begin;
+	int end;
+	JobCounter* counter;
+};
+
+// NOTE: Jobs are small and few per frame, a spinlock per deque keeps
+// contention low enough without a lock-free deque
+struct alignas(SDL_CACHELINE_SIZE) JobDeque
+{
+	SDL_SpinLock lock;
+	int top;						// Oldest job, stolen by other threads
+	int bottom;						// Next free slot, owner pushes and pops here
+	Job jobs[JOB_DEQUE_SIZE];
+};
+
+// Deque 0 is shared by threads outside the pool, then one per worker
+static JobDeque deques[MAX_JOB_WORKERS + 1];
+static SDL_Thread* threads[MAX_JOB_WORKERS];
+static int thread_count = 0;
+static int worker_count = 0;		// Deques to steal from, set before workers start
+
+static SDL_sem* wake = NULL;		// Posted once per queued job
+static SDL_atomic_t running;
+static SDL_atomic_t jobs_run;
+static SDL_atomic_t jobs_stolen;
+
+static thread_local int worker = 0;		// Deque owned by the current thread
+static thread_local bool serial = false;	// ParallelFor() runs inline on the current thread
+
+static bool PushJob(JobDeque* deque, const Job& job)
+{
+	bool pushed = false;
+
+	SDL_AtomicLock(&deque->lock);
+	if (deque->bottom - deque->top < JOB_DEQUE_SIZE)
+	{
+		deque->jobs[deque->bottom & (JOB_DEQUE_SIZE - 1)] = job;
+		deque->bottom++;
+		pushed = true;
+	}
+	SDL_AtomicUnlock(&deque->lock);
+
+	return pushed;
+}
+
+static bool PopJob(JobDeque* deque, Job* job)
+{
+	bool popped = false;
+
+	SDL_AtomicLock(&deque->lock);
+	if (deque->bottom > deque->top)
+	{
+		deque->bottom--;
+		*job = deque->jobs[deque->bottom & (JOB_DEQUE_SIZE - 1)];
+		popped = true;
+	}
+	SDL_AtomicUnlock(&deque->lock);
+
+	return popped;
+}
+
+static bool StealJob(JobDeque* deque, Job* job)
+{
+	// Someone else is on this deque, better try another one
+	if (!SDL_AtomicTryLock(&deque->lock)) return false;
+
+	bool stolen = false;
+
+	if (deque->bottom > deque->top)
+	{
+		*job = deque->jobs[deque->top & (JOB_DEQUE_SIZE - 1)];
+		deque->top++;
+		stolen = true;
+	}
+	SDL_AtomicUnlock(&deque->lock);
+
+	return stolen;
+}
+
+static bool FindJob(Job* job)
+{
+	if (PopJob(&deques[worker], job)) return true;
+
+	for (int i = 1; i <= worker_count; ++i)
+	{
+		if (StealJob(&deques[(worker + i)%(worker_count + 1)], job))
+		{
+			SDL_AtomicAdd(&jobs_stolen, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void ExecuteJob(const Job& job)
+{
+	job.function(job.begin, job.end, job.data);
+
+	SDL_AtomicAdd(&jobs_run, 1);
+	if (job.counter != NULL) SDL_AtomicAdd(&job.counter->pending, -1);
+}
+
+static int SDLCALL WorkerThread(void* data)
+{
+	worker = (int)(intptr_t)data;
+
+	Job job;
+
+	while (SDL_AtomicGet(&running))
+	{
+		if (FindJob(&job)) ExecuteJob(job);
+		else SDL_SemWait(wake);
+	}
+
+	return 0;
+}
+
+// ----------------------------------------------------------------
+void InitJobs(int workers)
+{
+	// Leave a core for the main thread, it runs jobs too while waiting
+	if (workers < 0) workers = SDL_GetCPUCount() - 1;
+	if (workers > MAX_JOB_WORKERS) workers = MAX_JOB_WORKERS;
+	if (workers < 0) workers = 0;
+
+	SDL_zeroa(deques);
+	SDL_AtomicSet(&jobs_run, 0);
+	SDL_AtomicSet(&jobs_stolen, 0);
+	SDL_AtomicSet(&running, 1);
+	thread_count = 0;
+	worker_count = 0;
+
+	if (workers == 0) return;
+
+	wake = SDL_CreateSemaphore(0);
+	if (wake == NULL)
+	{
+		printf("WARNING: Unable to create jobs semaphore, jobs will run serially! SDL Error: %s\n", SDL_GetError());
+		return;
+	}
+
+	// NOTE: A deque whose thread failed to start just stays empty
+	worker_count = workers;
+
+	for (int i = 0; i < workers; ++i)
+	{
+		char name[16];
+		SDL_snprintf(name, sizeof(name), "Worker %i", i + 1);
+
+		threads[thread_count] = SDL_CreateThread(WorkerThread, name, (void*)(intptr_t)(i + 1));
+		if (threads[thread_count] == NULL) printf("WARNING: Unable to create job worker thread! SDL Error: %s\n", SDL_GetError());
+		else thread_count++;
+	}
+
+	// Without any worker, jobs just run on the calling thread
+	if (thread_count == 0) worker_count = 0;
+}
+
+// ----------------------------------------------------------------
+void CloseJobs()
+{
+	SDL_AtomicSet(&running, 0);
+
+	for (int i = 0; i < thread_count; ++i) SDL_SemPost(wake);
+	for (int i = 0; i < thread_count; ++i) SDL_WaitThread(threads[i], NULL);
+
+	if (wake != NULL) SDL_DestroySemaphore(wake);
+	wake = NULL;
+	thread_count = 0;
+	worker_count = 0;
+}
+
+// ----------------------------------------------------------------
+void RunJob(JobFunction function, void* data, int begin, int end, JobCounter* counter)
+{
+	Job job = { function, data, begin, end, counter };
+
+	if (counter != NULL) SDL_AtomicAdd(&counter->pending, 1);
+
+	if ((worker_count > 0) && PushJob(&deques[worker], job)) SDL_SemPost(wake);
+	else ExecuteJob(job);
+}
+
+// ----------------------------------------------------------------
+void WaitJobs(JobCounter* counter)
+{
+	Job job;
+
+	while (SDL_AtomicGet(&counter->pending) > 0)
+	{
+		// Jobs waited for may be anywhere, run whatever is pending
+		if (FindJob(&job)) ExecuteJob(job);
+		else
+		{
+#if defined(__SSE2__)
+			_mm_pause();
+#else
+			SDL_Delay(0);
+#endif
+		}
+	}
+}
+
+// ----------------------------------------------------------------
+void ParallelFor(int count, int chunk, JobFunction function, void* data)
+{
+	if (chunk < 1) chunk = 1;
+
+	if ((worker_count == 0) || serial || (count <= chunk))
+	{
+		function(0, count, data);
+		return;
+	}
+
+	JobCounter counter;
+	SDL_AtomicSet(&counter.pending, 0);
+
+	for (int begin = 0; begin < count; begin += chunk)
+	{
+		RunJob(function, data, begin, SDL_min(begin + chunk, count), &counter);
+	}
+
+	WaitJobs(&counter);
+}
+
+// ----------------------------------------------------------------
+void SetSerialJobs(bool enabled)
+{
+	serial = enabled;
+}
+
+// ----------------------------------------------------------------
+JobStats GetJobStats()
+{
+	JobStats stats;
+
+	stats.workers = thread_count;
+	stats.jobs = SDL_AtomicGet(&jobs_run);
+	stats.stolen = SDL_AtomicGet(&jobs_stolen);
+
+	return stats;
+}
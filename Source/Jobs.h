@@ -0,0 +1,58 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Jobs - Work-stealing job system
+//
+// Every worker thread owns a deque of jobs: it pushes and pops its own
+// newest jobs, while idle workers steal the oldest ones from the others.
+// Threads outside the pool (main thread) share one extra deque.
+// A thread waiting for a counter runs pending jobs instead of blocking.
+// -------------------------------------------------------------------------
+
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define MAX_JOB_WORKERS		   8
+#define JOB_DEQUE_SIZE		 256	// Must be a power of two
+
+// Job body, called for the index range [begin, end)
+typedef void (*JobFunction)(int begin, int end, void* data);
+
+// Jobs still pending, a job decrements it once finished
+// NOTE: Initialize it with SDL_AtomicSet(&counter.pending, 0)
+struct JobCounter
+{
+	SDL_atomic_t pending;
+};
+
+struct JobStats
+{
+	int workers;		// Worker threads, 0 runs every job on the calling thread
+	int jobs;			// Jobs run
+	int stolen;			// Jobs run by a thread that did not push them
+};
+
+// Start the worker threads, a negative count picks one from the CPU count
+void InitJobs(int workers);
+// WARNING: Every counter must be waited before closing
+void CloseJobs();
+
+// Queue a job, counter (may be NULL) is incremented now and decremented once it finished
+// NOTE: Without workers, or with the deque full, the job runs right away
+void RunJob(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+
+// Wait until all the jobs tracked by counter finished, running jobs meanwhile
+void WaitJobs(JobCounter* counter);
+
+// Split [0, count) in jobs of chunk indices and wait for all of them
+// NOTE: Order of execution is not defined, reduce any result afterwards
+void ParallelFor(int count, int chunk, JobFunction function, void* data);
+
+// Current thread only: ParallelFor() runs the whole range inline
+// NOTE: For jobs already coarse enough, splitting them again only adds overhead
+void SetSerialJobs(bool enabled);
+
+JobStats GetJobStats();
+
+#endif // __JOBS_H__
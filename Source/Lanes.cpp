@@ -0,0 +1,352 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Lanes - Independent games stepped together, one per SIMD lane
+// -------------------------------------------------------------------------
+
+#include "Lanes.h"
+#include "Input.h"
+
+#if defined(__SSE2__)
+// Spawn one asteroid per lane of the screen, except the gap one, as SpawnWave()
+static void SpawnLaneWave(SimLanes* lanes, int lane, int gap)
+{
+	if (lanes->last_shot[lane] == MAX_SHIP_SHOTS) lanes->last_shot[lane] = 0;
+
+	for (int l = 0; l < WAVE_LANES; ++l)
+	{
+		if (l == gap) continue;
+
+		int shot = lanes->last_shot[lane];
+
+		lanes->alive[lane] |= (1u << shot);
+		lanes->shot_x[shot][lane] = (Sint16)(WAVE_FIRST_LANE_X + l*WAVE_LANE_WIDTH);
+		lanes->shot_y[shot][lane] = -20;
+		lanes->last_shot[lane]++;
+	}
+}
+
+// Title and ending rules: any player pressing confirm moves on
+static void UpdateLaneScreen(SimLanes* lanes, int lane, Uint32 held, Uint32 prev_held)
+{
+	Uint32 pressed = held & ~prev_held;
+	bool confirm = false;
+
+	for (int p = 0; p < lanes->players[lane]; ++p) if (pressed & ACTION_BIT(ACTION_CONFIRM + p*PLAYER_ACTION_BITS)) confirm = true;
+
+	if (!confirm) return;
+
+	if (lanes->screen[lane] == TITLE)
+	{
+		lanes->screen[lane] = GAMEPLAY;
+		lanes->ships_alive[lane] = (Uint8)((1u << lanes->players[lane]) - 1);
+	}
+	else lanes->screen[lane] = TITLE;
+}
+
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Lanes where action is held, 0xFFFF or 0 each
+static inline __m128i ActionHeld(__m128i actions, Action action)
+{
+	__m128i bit = _mm_set1_epi16((short)ACTION_BIT(action));
+
+	return _mm_cmpeq_epi16(_mm_and_si128(actions, bit), bit);
+}
+
+// GameplayUpdate() ship rules for one player, held and prev_held already shifted to player 1 bits
+static __m128i MoveShips(__m128i x, __m128i held, __m128i prev_held, __m128i active)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i left_held = ActionHeld(held, ACTION_MOVE_LEFT);
+	__m128i right_held = ActionHeld(held, ACTION_MOVE_RIGHT);
+	__m128i left_repeat = _mm_and_si128(left_held, ActionHeld(prev_held, ACTION_MOVE_LEFT));
+	__m128i right_repeat = _mm_and_si128(right_held, ActionHeld(prev_held, ACTION_MOVE_RIGHT));
+	__m128i left_idle = _mm_cmpeq_epi16(_mm_or_si128(left_held, ActionHeld(prev_held, ACTION_MOVE_LEFT)), zero);
+	__m128i right_idle = _mm_cmpeq_epi16(_mm_or_si128(right_held, ActionHeld(prev_held, ACTION_MOVE_RIGHT)), zero);
+
+	__m128i inside = _mm_and_si128(_mm_cmpgt_epi16(x, _mm_set1_epi16(SHIP_MIN_X - 1)), _mm_cmplt_epi16(x, _mm_set1_epi16(SHIP_MAX_X + 1)));
+	inside = _mm_and_si128(inside, active);
+	__m128i outside = _mm_andnot_si128(inside, active);
+
+	// Left wins when both are held
+	__m128i move_left = _mm_and_si128(inside, left_repeat);
+	__m128i move_right = _mm_andnot_si128(left_repeat, _mm_and_si128(inside, right_repeat));
+
+	__m128i snap_right = _mm_and_si128(outside, _mm_and_si128(_mm_cmplt_epi16(x, _mm_set1_epi16(SHIP_MIN_X)), _mm_and_si128(right_repeat, left_idle)));
+	__m128i snap_left = _mm_andnot_si128(snap_right, _mm_and_si128(outside, _mm_and_si128(_mm_cmpgt_epi16(x, _mm_set1_epi16(SHIP_MIN_X)), _mm_and_si128(left_repeat, right_idle))));
+
+	__m128i speed = _mm_set1_epi16(SHIP_SPEED);
+	x = _mm_sub_epi16(x, _mm_and_si128(move_left, speed));
+	x = _mm_add_epi16(x, _mm_and_si128(move_right, speed));
+	x = Select(snap_right, _mm_set1_epi16(SHIP_MIN_X), x);
+
+	return Select(snap_left, _mm_set1_epi16(SHIP_MAX_X), x);
+}
+
+// Lanes where asteroid i is alive, from the alive masks of lanes 0-3 and 4-7
+static inline __m128i AsteroidAlive(__m128i alive_low, __m128i alive_high, int i)
+{
+	__m128i bit = _mm_set1_epi32((int)(1u << i));
+
+	return _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(alive_low, bit), bit), _mm_cmpeq_epi32(_mm_and_si128(alive_high, bit), bit));
+}
+
+// One bit per lane set in mask
+static inline int LaneBits(__m128i mask)
+{
+	return _mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128()));
+}
+
+// Rows are 8 asteroids of every lane, columns come out as the 8 asteroids of each game
+static void TransposeShots(const Sint16 (*rows)[SIM_LANES], Sint16* columns, int stride)
+{
+	__m128i r[8];
+	for (int k = 0; k < 8; ++k) r[k] = _mm_load_si128((const __m128i*)rows[k]);
+
+	__m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+	__m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	__m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	__m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+	__m128i c[8] =
+	{
+		_mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4),
+		_mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+		_mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6),
+		_mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7)
+	};
+
+	for (int lane = 0; lane < SIM_LANES; ++lane) _mm_storeu_si128((__m128i*)(columns + lane*stride), c[lane]);
+}
+#endif
+
+// ----------------------------------------------------------------
+void SetSimLane(SimLanes* lanes, int lane, const SimState* sim)
+{
+	lanes->tick[lane] = sim->tick;
+	lanes->rng[lane] = sim->rng;
+	lanes->alive[lane] = sim->alive;
+	for (int p = 0; p < MAX_PLAYERS; ++p) lanes->ship_x[p][lane] = sim->ship_x[p];
+	lanes->ship_y[lane] = sim->ship_y;
+	lanes->scroll[lane] = sim->scroll;
+	lanes->actions[lane] = sim->actions;
+	lanes->screen[lane] = sim->screen;
+	lanes->last_shot[lane] = sim->last_shot;
+	lanes->wave_gap[lane] = sim->wave_gap;
+	lanes->players[lane] = sim->players;
+	lanes->ships_alive[lane] = sim->ships_alive;
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		lanes->shot_x[i][lane] = sim->shot_x[i];
+		lanes->shot_y[i][lane] = sim->shot_y[i];
+	}
+}
+
+// ----------------------------------------------------------------
+void GetSimLane(const SimLanes* lanes, int lane, SimState* sim)
+{
+	SDL_zerop(sim);
+
+	sim->tick = lanes->tick[lane];
+	sim->rng = lanes->rng[lane];
+	sim->alive = lanes->alive[lane];
+	for (int p = 0; p < MAX_PLAYERS; ++p) sim->ship_x[p] = lanes->ship_x[p][lane];
+	sim->ship_y = lanes->ship_y[lane];
+	sim->scroll = lanes->scroll[lane];
+	sim->actions = (Uint8)lanes->actions[lane];
+	sim->screen = lanes->screen[lane];
+	sim->last_shot = lanes->last_shot[lane];
+	sim->wave_gap = lanes->wave_gap[lane];
+	sim->players = lanes->players[lane];
+	sim->ships_alive = lanes->ships_alive[lane];
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		sim->shot_x[i] = lanes->shot_x[i][lane];
+		sim->shot_y[i] = lanes->shot_y[i][lane];
+	}
+}
+
+// ----------------------------------------------------------------
+void UnpackSimLanes(const SimLanes* lanes, SimState* sims)
+{
+#if defined(__SSE2__)
+	// Asteroids are most of the state, they move 8 by 8 with transposes
+	// NOTE: Padding is left as it was, HashSim() skips it anyway
+	const int stride = sizeof(SimState)/sizeof(Sint16);
+
+	for (int lane = 0; lane < SIM_LANES; ++lane)
+	{
+		SimState* sim = &sims[lane];
+
+		sim->tick = lanes->tick[lane];
+		sim->rng = lanes->rng[lane];
+		sim->alive = lanes->alive[lane];
+		for (int p = 0; p < MAX_PLAYERS; ++p) sim->ship_x[p] = lanes->ship_x[p][lane];
+		sim->ship_y = lanes->ship_y[lane];
+		sim->scroll = lanes->scroll[lane];
+		sim->actions = (Uint8)lanes->actions[lane];
+		sim->screen = lanes->screen[lane];
+		sim->last_shot = lanes->last_shot[lane];
+		sim->wave_gap = lanes->wave_gap[lane];
+		sim->players = lanes->players[lane];
+		sim->ships_alive = lanes->ships_alive[lane];
+	}
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; i += 8)
+	{
+		TransposeShots(&lanes->shot_x[i], &sims[0].shot_x[i], stride);
+		TransposeShots(&lanes->shot_y[i], &sims[0].shot_y[i], stride);
+	}
+#else
+	for (int lane = 0; lane < SIM_LANES; ++lane) GetSimLane(lanes, lane, &sims[lane]);
+#endif
+}
+
+// ----------------------------------------------------------------
+void MoveStuffLanes(SimLanes* lanes, const Uint32* actions)
+{
+#if defined(__SSE2__)
+	alignas(16) Sint16 prev_held[SIM_LANES];
+	alignas(16) Sint16 gameplay[SIM_LANES];
+	alignas(16) Sint16 ships[MAX_PLAYERS][SIM_LANES];		// Ship p moves and collides in lane
+	alignas(16) Sint16 spawns[SIM_LANES];
+	Uint32 left_screen[SIM_LANES] = { 0 };
+
+	// Per game work first: screen rules outside gameplay, random gaps inside
+	for (int lane = 0; lane < SIM_LANES; ++lane)
+	{
+		prev_held[lane] = lanes->actions[lane];
+		lanes->actions[lane] = (Uint8)actions[lane];
+		gameplay[lane] = (lanes->screen[lane] == GAMEPLAY)? -1 : 0;
+
+		for (int p = 0; p < MAX_PLAYERS; ++p)
+		{
+			ships[p][lane] = ((gameplay[lane] != 0) && (p < lanes->players[lane]))? -1 : 0;
+		}
+
+		if (gameplay[lane] == 0) UpdateLaneScreen(lanes, lane, actions[lane], (Uint8)prev_held[lane]);
+		else if (lanes->tick[lane]%SIM_TICK_RATE == 0) lanes->wave_gap[lane] = NextRandom(&lanes->rng[lane])%WAVE_LANES;
+	}
+
+	__m128i active = _mm_load_si128((const __m128i*)gameplay);
+
+	if (LaneBits(active) != 0)
+	{
+		__m128i held = _mm_load_si128((const __m128i*)lanes->actions);
+		__m128i prev = _mm_load_si128((const __m128i*)prev_held);
+
+		__m128i scroll = _mm_sub_epi16(_mm_load_si128((const __m128i*)lanes->scroll), _mm_set1_epi16(SCROLL_SPEED));
+		scroll = Select(_mm_cmplt_epi16(scroll, _mm_set1_epi16(1)), _mm_set1_epi16(BACKGROUND_HEIGHT), scroll);
+		_mm_store_si128((__m128i*)lanes->scroll, Select(active, scroll, _mm_load_si128((const __m128i*)lanes->scroll)));
+
+		__m128i ship_x[MAX_PLAYERS];
+		__m128i ship_hit[MAX_PLAYERS];
+		__m128i ship_alive[MAX_PLAYERS];
+
+		for (int p = 0; p < MAX_PLAYERS; ++p)
+		{
+			__m128i moving = _mm_load_si128((const __m128i*)ships[p]);
+			__m128i x = _mm_load_si128((const __m128i*)lanes->ship_x[p]);
+
+			x = MoveShips(x, _mm_srli_epi16(held, p*PLAYER_ACTION_BITS), _mm_srli_epi16(prev, p*PLAYER_ACTION_BITS), moving);
+			_mm_store_si128((__m128i*)lanes->ship_x[p], x);
+
+			Sint16 alive_bits[SIM_LANES];
+			for (int lane = 0; lane < SIM_LANES; ++lane) alive_bits[lane] = (lanes->ships_alive[lane] & (1u << p))? -1 : 0;
+
+			ship_x[p] = x;
+			ship_hit[p] = _mm_setzero_si128();
+			ship_alive[p] = _mm_and_si128(moving, _mm_loadu_si128((const __m128i*)alive_bits));
+		}
+
+		// Asteroids fall and collide in every lane at once
+		// NOTE: As in UpdateAsteroids(), dead asteroids still collide where they were left
+		__m128i alive_low = _mm_load_si128((const __m128i*)&lanes->alive[0]);
+		__m128i alive_high = _mm_load_si128((const __m128i*)&lanes->alive[4]);
+		__m128i ship_top = _mm_load_si128((const __m128i*)lanes->ship_y);
+		__m128i ship_bottom = _mm_add_epi16(ship_top, _mm_set1_epi16(SHIP_SIZE));
+		__m128i reached = _mm_setzero_si128();
+
+		for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+		{
+			__m128i alive = _mm_and_si128(active, AsteroidAlive(alive_low, alive_high, i));
+			__m128i y = _mm_load_si128((const __m128i*)lanes->shot_y[i]);
+			__m128i falling = _mm_cmplt_epi16(y, _mm_set1_epi16(SCREEN_HEIGHT));
+			__m128i stopped = _mm_andnot_si128(falling, alive);
+			__m128i gone = _mm_and_si128(stopped, _mm_cmpgt_epi16(y, _mm_set1_epi16(SCREEN_HEIGHT + 100)));
+
+			y = _mm_add_epi16(y, _mm_and_si128(_mm_and_si128(alive, falling), _mm_set1_epi16(SHOT_SPEED)));
+			_mm_store_si128((__m128i*)lanes->shot_y[i], y);
+
+			// Counts go up by one where the mask is -1
+			reached = _mm_sub_epi16(reached, _mm_andnot_si128(gone, stopped));
+
+			int gone_lanes = LaneBits(gone);
+			if (gone_lanes != 0) for (int lane = 0; lane < SIM_LANES; ++lane) if (gone_lanes & (1 << lane)) left_screen[lane] |= (1u << i);
+
+			__m128i x = _mm_load_si128((const __m128i*)lanes->shot_x[i]);
+			__m128i inside_y = _mm_and_si128(_mm_cmplt_epi16(ship_top, y), _mm_cmpgt_epi16(ship_bottom, y));
+
+			for (int p = 0; p < MAX_PLAYERS; ++p)
+			{
+				__m128i inside_x = _mm_and_si128(_mm_cmplt_epi16(ship_x[p], x), _mm_cmpgt_epi16(_mm_add_epi16(ship_x[p], _mm_set1_epi16(SHIP_SIZE)), x));
+				ship_hit[p] = _mm_or_si128(ship_hit[p], _mm_and_si128(ship_alive[p], _mm_and_si128(inside_x, inside_y)));
+			}
+		}
+
+		_mm_store_si128((__m128i*)spawns, reached);
+
+		int hit_lanes[MAX_PLAYERS];
+		for (int p = 0; p < MAX_PLAYERS; ++p) hit_lanes[p] = LaneBits(ship_hit[p]);
+
+		// Per game again: asteroids gone are freed before waves reuse their slots, hits end the round
+		for (int lane = 0; lane < SIM_LANES; ++lane)
+		{
+			if (gameplay[lane] == 0) continue;
+
+			lanes->alive[lane] &= ~left_screen[lane];
+			for (int n = 0; n < spawns[lane]; ++n) SpawnLaneWave(lanes, lane, lanes->wave_gap[lane]);
+
+			Uint8 hit = 0;
+			for (int p = 0; p < MAX_PLAYERS; ++p) if (hit_lanes[p] & (1 << lane)) hit |= (Uint8)(1u << p);
+
+			if (hit != 0)
+			{
+				lanes->ships_alive[lane] &= (Uint8)~hit;
+				lanes->screen[lane] = ENDING;
+			}
+		}
+	}
+
+	for (int lane = 0; lane < SIM_LANES; ++lane) lanes->tick[lane]++;
+#else
+	for (int lane = 0; lane < SIM_LANES; ++lane)
+	{
+		SimState sim;
+
+		GetSimLane(lanes, lane, &sim);
+		MoveStuff(&sim, actions[lane], NULL);
+		SetSimLane(lanes, lane, &sim);
+	}
+#endif
+}
+
+// ----------------------------------------------------------------
+const char* GetLanesKernel()
+{
+#if defined(__SSE2__)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,59 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Lanes - Independent games stepped together, one per SIMD lane
+//
+// SimLanes keeps SIM_LANES games field by field (structure of arrays):
+// the positions of one asteroid in every game fill a single 16-bit SSE2
+// register, so the gameplay rules (ships, scroll, asteroids fall and
+// collisions) run once for all of them, with masks where games differ.
+// Rare per game work, screen changes, random waves and wave spawns,
+// runs game by game afterwards.
+//
+// The rules are the MoveStuff() ones: a game packed, stepped and unpacked
+// hashes like the same game stepped alone. Audio and reflected actions
+// are not produced, lanes are meant for headless games.
+// -------------------------------------------------------------------------
+
+#ifndef __LANES_H__
+#define __LANES_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+
+#define SIM_LANES			   8		// Games per SimLanes, one per 16-bit SSE2 lane
+
+// SimState fields, each one for every game
+struct alignas(16) SimLanes
+{
+	Uint32 tick[SIM_LANES];
+	Uint32 rng[SIM_LANES];
+	Uint32 alive[SIM_LANES];
+	Sint16 ship_x[MAX_PLAYERS][SIM_LANES];
+	Sint16 ship_y[SIM_LANES];
+	Sint16 scroll[SIM_LANES];
+	Sint16 actions[SIM_LANES];				// Widened, shifted and tested in registers
+	Uint8 screen[SIM_LANES];
+	Uint8 last_shot[SIM_LANES];
+	Uint8 wave_gap[SIM_LANES];
+	Uint8 players[SIM_LANES];
+	Uint8 ships_alive[SIM_LANES];
+
+	alignas(16) Sint16 shot_x[MAX_SHIP_SHOTS][SIM_LANES];
+	Sint16 shot_y[MAX_SHIP_SHOTS][SIM_LANES];
+};
+
+// Copy sim in and out of lane
+void SetSimLane(SimLanes* lanes, int lane, const SimState* sim);
+void GetSimLane(const SimLanes* lanes, int lane, SimState* sim);
+
+// Copy the SIM_LANES games out to sims
+void UnpackSimLanes(const SimLanes* lanes, SimState* sims);
+
+// Advance every game one tick, actions holds SIM_LANES masks as MoveStuff() takes them
+void MoveStuffLanes(SimLanes* lanes, const Uint32* actions);
+
+// Kernel compiled in: "sse2", or "scalar" stepping every game with MoveStuff()
+const char* GetLanesKernel();
+
+#endif // __LANES_H__
@@ -0,0 +1,136 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Latency - Input to photon latency measurement
+// -------------------------------------------------------------------------
+
+#include "Latency.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+static bool enabled = false;
+static Uint64 pending[ACTION_COUNT];		// Edge time not reflected yet, per action
+static Uint64 reflected = 0;				// Oldest edge reflected and not presented yet
+static SDL_SpinLock reflected_lock = 0;		// Simulation and render sides touch reflected
+
+static int histogram[LATENCY_BUCKETS];
+static int samples = 0;
+static double total_ms = 0.0;
+static double min_ms = 0.0;
+static double max_ms = 0.0;
+
+// ----------------------------------------------------------------
+void InitLatency(bool enable)
+{
+	enabled = enable;
+	reflected = 0;
+	samples = 0;
+	total_ms = 0.0;
+	SDL_zeroa(pending);
+	SDL_zeroa(histogram);
+}
+
+// ----------------------------------------------------------------
+bool IsLatencyEnabled()
+{
+	return enabled;
+}
+
+// ----------------------------------------------------------------
+void TagInputEdge(int action, Uint64 time)
+{
+	if (enabled && (action >= 0) && (action < ACTION_COUNT)) pending[action] = time;
+}
+
+// ----------------------------------------------------------------
+void MarkInputReflected(int action)
+{
+	// NOTE: Holding a key keeps changing the state, only the first change counts
+	if (!enabled || (pending[action] == 0)) return;
+
+	SDL_AtomicLock(&reflected_lock);
+	if ((reflected == 0) || (pending[action] < reflected)) reflected = pending[action];
+	SDL_AtomicUnlock(&reflected_lock);
+
+	pending[action] = 0;
+}
+
+// ----------------------------------------------------------------
+Uint64 GetReflectedTag()
+{
+	SDL_AtomicLock(&reflected_lock);
+	Uint64 tag = reflected;
+	SDL_AtomicUnlock(&reflected_lock);
+
+	return tag;
+}
+
+// ----------------------------------------------------------------
+void RecordPresent(Uint64 tag)
+{
+	if (!enabled || (tag == 0)) return;
+
+	// Snapshots keep carrying the tag until one showing it is presented, only that first present counts
+	SDL_AtomicLock(&reflected_lock);
+	bool first = (tag == reflected);
+	if (first) reflected = 0;
+	SDL_AtomicUnlock(&reflected_lock);
+
+	if (!first) return;
+
+	double ms = (double)(SDL_GetPerformanceCounter() - tag)*1000.0/SDL_GetPerformanceFrequency();
+	int bucket = (int)ms;
+	if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+
+	histogram[bucket]++;
+	if ((samples == 0) || (ms < min_ms)) min_ms = ms;
+	if ((samples == 0) || (ms > max_ms)) max_ms = ms;
+	total_ms += ms;
+	samples++;
+}
+
+static int Percentile(int percent)
+{
+	int target = (samples*percent + 99)/100;
+	int count = 0;
+
+	for (int i = 0; i < LATENCY_BUCKETS; ++i)
+	{
+		count += histogram[i];
+		if (count >= target) return i + 1;
+	}
+
+	return LATENCY_BUCKETS;
+}
+
+// ----------------------------------------------------------------
+void PrintLatencyReport()
+{
+	if (!enabled) return;
+
+	if (samples == 0)
+	{
+		printf("Input to photon latency: no samples\n");
+		return;
+	}
+
+	printf("Input to photon latency: %i samples, min %.2f ms, avg %.2f ms, max %.2f ms\n", samples, min_ms, total_ms/samples, max_ms);
+	printf("  p50 < %i ms, p90 < %i ms, p99 < %i ms\n", Percentile(50), Percentile(90), Percentile(99));
+
+	int peak = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; ++i) if (histogram[i] > peak) peak = histogram[i];
+
+	for (int i = 0; i < LATENCY_BUCKETS; ++i)
+	{
+		if (histogram[i] == 0) continue;
+
+		char bar[41];
+		int length = histogram[i]*40/peak;
+		if (length == 0) length = 1;
+		SDL_memset(bar, '#', length);
+		bar[length] = '\0';
+
+		if (i == LATENCY_BUCKETS - 1) printf("  >=%2i ms %6i %s\n", i, histogram[i], bar);
+		else printf("  %3i ms %6i %s\n", i, histogram[i], bar);
+	}
+}
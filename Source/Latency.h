@@ -0,0 +1,38 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Latency - Input to photon latency measurement
+//
+// Every action edge is tagged with the time SDL received it. When the
+// simulation first changes something visible because of that action, the tag
+// rides on every snapshot published until one of them is drawn, and the time
+// SDL_RenderPresent() returns for that frame closes the measure.
+// -------------------------------------------------------------------------
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define LATENCY_BUCKETS		 100	// 1 ms histogram buckets, last one holds everything slower
+
+void InitLatency(bool enabled);
+bool IsLatencyEnabled();
+
+// Input side: action edge applied to the simulation, time from InputEvent
+void TagInputEdge(int action, Uint64 time);
+
+// Simulation side: current tick visibly reacted to the action
+void MarkInputReflected(int action);
+
+// Simulation side: tag carried by the snapshot being published, the oldest edge reflected and not presented yet (0 if none)
+// NOTE: Every snapshot published carries it until a present records it, so ticks overwriting
+// unread snapshots don't lose it; edges reflected meanwhile are not measured on their own
+Uint64 GetReflectedTag();
+
+// Render side: record the snapshot tag once SDL_RenderPresent() returned, once per tag
+void RecordPresent(Uint64 tag);
+
+// Print the histogram and percentiles for the whole session
+void PrintLatencyReport();
+
+#endif // __LATENCY_H__
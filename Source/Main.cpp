@@ -15,6 +15,27 @@
 #include "SDL_image/include/SDL_image.h"	// Required for image loading functionality
 #include "SDL_mixer/include/SDL_mixer.h"	// Required for audio loading and playing functionality
 
+#include "Audio.h"							// Required for sound effects voice pool
+#include "Mixer.h"							// Required for in-house mixer benchmark
+#include "Input.h"							// Required for timestamped keyboard events
+#include "Latency.h"						// Required for input to photon latency measurement
+#include "TripleBuffer.h"					// Required for simulation to render snapshots
+#include "Jobs.h"							// Required for parallel asteroids update
+#include "FrameGraph.h"						// Required for frame tasks scheduling
+#include "Game.h"							// Required for simulation state and rules
+#include "Rewind.h"							// Required for snapshots and rewind
+#include "Replay.h"							// Required for recording and playing back sessions
+#include "Net.h"							// Required for netplay transports
+#include "Rollback.h"						// Required for netplay sessions
+#include "Spectate.h"						// Required for live broadcast to spectators
+#include "Bot.h"							// Required for scripted players
+#include "Batch.h"							// Required for headless bot games
+#include "Env.h"							// Required for learning environments benchmark
+#include "Golden.h"							// Required for golden image comparison
+#include "Capture.h"						// Required for gameplay video capture
+#include "Pacing.h"							// Required for frame rate limiter
+#include "Governor.h"						// Required for dynamic resolution
+
 // Define libraries required by linker
 // WARNING: Not all compilers support this option and it couples 
 // source code with build system, it's recommended to keep both 
@@ -27,17 +48,27 @@
 // -------------------------------------------------------------------------
 // Defines, Types and Globals
 // -------------------------------------------------------------------------
-#define SCREEN_WIDTH		901
-#define SCREEN_HEIGHT		901
-
-#define MAX_KEYBOARD_KEYS	 256
 #define MAX_MOUSE_BUTTONS	   5
 #define JOYSTICK_DEAD_ZONE  8000
 
-#define SHIP_SPEED			   8
-#define MAX_SHIP_SHOTS		 32
-#define SHOT_SPEED		12
-#define SCROLL_SPEED		   19
+#define MAX_TICKS_PER_FRAME	    4		// Simulation catch up limit
+
+#define MAX_DRAW_COMMANDS	   64
+
+#define BENCH_RENDER_FRAMES	  600		// Frames drawn per renderer and vsync mode, see --bench-renderers
+
+// Debug requests from the frame keyboard, applied by the simulation between ticks
+#define SIM_REQUEST_SAVE	 0x01		// F5: Save snapshot
+#define SIM_REQUEST_LOAD	 0x02		// F9: Load snapshot
+#define SIM_REQUEST_REWIND	 0x04		// BACKSPACE: Rewind one second
+
+enum NetplayMode
+{
+	NETPLAY_OFF = 0,
+	NETPLAY_HOST,						// Player 0, waits for the peer
+	NETPLAY_JOIN,						// Player 1, adopts the host seed
+	NETPLAY_LOOPBACK					// Both players in process, player 2 on its own keys
+};
 
 enum WindowEvent
 {
@@ -47,76 +78,170 @@ enum WindowEvent
 	WE_COUNT
 };
 
-enum KeyState
+// Everything drawing needs from the simulation, published once per tick
+// NOTE: Drawing only ever reads snapshots, never the simulation state
+struct RenderSnapshot
 {
-	KEY_IDLE = 0,		// DEFAULT
-	KEY_DOWN,			// PRESSED (DEFAULT->DOWN)
-	KEY_REPEAT,			// KEEP DOWN (sustained)
-	KEY_UP				// RELEASED (DOWN->DEFAULT)
+	SimState sim;
+	Uint64 latency_tag;					// Input edge shown by this snapshot and not presented yet (0 if none)
 };
-enum GameScreen
+
+// GlobalState sections, frame tasks declare the ones they read and write
+// NOTE: Snapshots go through the triple buffer instead of a section,
+// so drawing never waits for the simulation
+enum StateSection
 {
-	TITLE = 0,
-	GAMEPLAY,
-	ENDING
+	SECTION_EVENTS = 1 << 0,			// Window, mouse and gamepad state, input events queue
+	SECTION_GAME = 1 << 1,				// Simulation state, only the simulation touches it
+	SECTION_AUDIO_COMMANDS = 1 << 2,	// Audio requested by the simulation
+	SECTION_AUDIO = 1 << 3,				// SDL_mixer, sound fx voices and music
+	SECTION_DRAW_LIST = 1 << 4,
+	SECTION_RENDERER = 1 << 5
 };
 
-struct Projectile
+// Textures are loaded by the screens using them, see screen_views
+enum TextureId
 {
-	int x, y;
-	bool alive;
+	TEXTURE_BACKGROUND = 0,
+	TEXTURE_SHIP,
+	TEXTURE_SHIP2,						// Same ship, tinted for player 2
+	TEXTURE_SHOT,
+	TEXTURE_GAMEOVER,
+	TEXTURE_PLAYGAME,
+	TEXTURE_COUNT
 };
 
-// Global context to store our game state data
-struct GlobalState
+// NOTE: Textures are referenced by id, the screen may still be loading them
+struct DrawCommand
+{
+	TextureId texture;
+	SDL_Rect rec;
+};
+
+struct DrawList
+{
+	Uint32 tick;				// Snapshot drawn
+	GameScreen screen;
+	Uint64 latency_tag;
+	int count;
+	DrawCommand commands[MAX_DRAW_COMMANDS];
+};
+
+// Platform handles and loaded assets, set up once and never touched by the simulation
+struct Resources
 {
 	// Window and renderer
 	SDL_Window* window;
 	SDL_Surface* surface;
 	SDL_Renderer* renderer;
+	SDL_Texture* target;		// Offscreen render target, see --golden-target and --governor
+	SDL_Joystick* gamepad;
+
+	// Texture variables, only the current screen ones are loaded
+	SDL_Texture* textures[TEXTURE_COUNT];
+
+	// Audio variables
+	Mix_Music* music;
+	Mix_Music* ending;
+};
 
+// Global context to store our frame state data
+// NOTE: Game elements live in SimState, see Game.h
+struct GlobalState
+{
 	// Input events
-	KeyState* keyboard;
 	KeyState mouse_buttons[MAX_MOUSE_BUTTONS];
 	int mouse_x;
 	int mouse_y;
-	SDL_Joystick* gamepad;
 	int gamepad_axis_x_dir;
 	int gamepad_axis_y_dir;
 	bool window_events[WE_COUNT];
+	Uint8 sim_requests;				// SIM_REQUEST_* pressed this frame
+	bool replaying;					// Actions come from the replay instead of the keyboard
+	bool replay_desync;				// Replay hashes stopped matching
+	bool net_connected;				// Netplay peers agreed on the seed, ticks run
+	bool broadcast_ended;			// Spectating, the stream closed
+
+	// Frame
+	bool running;
+	Uint64 next_tick;				// Performance counter time of next simulation tick
+	Uint32 ticks_run;				// Ticks simulated, sim.tick goes back on rewind
+	Uint32 sim_hash;				// HashSim() after the last tick
+	Uint64 sim_time;				// Performance counter ticks spent in MoveStuff()
+	Uint32 drawn_tick;				// Last snapshot presented
+	GameScreen shown_screen;		// Screen whose textures are loaded
+	bool resize_audio;				// Back to the title, music is stopped: apply the suggested audio buffer
+	AudioCommandList audio;
+	DrawList draw_list;
+};
 
-	// Texture variables
-	SDL_Texture* background;
-	SDL_Texture* ship;
-	SDL_Texture* shot;
-	SDL_Texture* gameover;
-	SDL_Texture* playgame;
-	int background_width;
-	int background_height;
+typedef void (*ScreenViewFunction)();
 
-	// Audio variables
-	Mix_Music* music;
-	Mix_Music* ending;
+// Screen drawing, enter and exit load and release the screen textures
+// NOTE: Enter and exit run on the main thread, draw on any thread
+struct ScreenView
+{
+	ScreenViewFunction enter;
+	ScreenViewFunction exit;
+	void (*draw)(const SimState* sim, DrawList* list);
+};
 
-	// Game elements
-	int ship_x;
-	int ship_y;
-	int scroll;
-	Projectile shots[MAX_SHIP_SHOTS];
-	int last_shot;
-	int shot_w;
-	int shot_h;
-	
-	
-	int ship_w;
-	int ship_h;
-
-	GameScreen currentScreen;		// 0-LOGO, 1-TITLE, 2-GAMEPLAY, 3-ENDING
+// Command line options
+struct GameOptions
+{
+	bool custom_mixer = false;				// --custom-mixer: Mix sound effects with the in-house mixer
+	bool bench_mixer = false;				// --bench-mixer: Run the mixer benchmark and exit
+	int audio_buffer = 1024;				// --audio-buffer <samples>: Fixed audio callback size
+	bool adaptive_audio = true;				// Audio callback size adapts unless --audio-buffer is used
+	bool latency = false;					// --latency: Measure input to photon latency
+	int jobs = -1;							// --jobs <workers>: Job worker threads, picked from CPU count by default
+	Uint32 seed = 0;						// --seed <n>: Asteroid waves seed, picked from the clock by default
+	const char* frame_trace = NULL;			// --frame-trace <file>: Write last frames tasks timings on exit
+	const char* snapshot = "snapshot.sim";	// --snapshot <file>: File saved with F5 and loaded with F9
+	const char* record = NULL;				// --record <file>: Record the session as a replay
+	const char* replay = NULL;				// --replay <file>: Play back a replay, then go on with the keyboard
+	Uint32 replay_start = 0;				// --replay-from <tick>: Tick the replay starts playing from
+	const char* check = NULL;				// --check <file>: Simulate a replay again, compare its hashes and exit
+	int players = 1;						// --versus: Two players on one keyboard
+	NetplayMode netplay = NETPLAY_OFF;		// --host <port>, --join <host:port>, --netplay-loopback
+	const char* net_host = NULL;
+	int net_port = 0;
+	int net_latency = 0;					// --net-latency <ms>: Delay every packet sent
+	int net_loss = 0;						// --net-loss <percent>: Drop packets sent
+	int broadcast_port = 0;					// --broadcast <port>: Stream the game to spectators
+	const char* spectate_host = NULL;		// --spectate <host:port>: Watch a broadcast instead of playing
+	int spectate_port = 0;
+	int spectate_check = 0;					// --spectate-check <port>: Broadcast bot games to spectators in the same process, compare their views and exit
+	BotSkill bots[MAX_PLAYERS] = { BOT_OFF, BOT_OFF };	// --bot <skill>, --bot2 <skill>: Scripted players
+	int batch = 0;							// --batch <games>: Play games headless with bots, print survival stats and exit
+	int batch_ticks = BATCH_GAME_TICKS;		// --batch-ticks <ticks>: Length of every batch game
+	bool batch_scalar = false;				// --batch-scalar: Step batch games one by one instead of SIM_LANES at once
+	bool batch_check = false;				// --batch-check: Compare every lane game against the scalar step
+	bool bench_env = false;					// --bench-env: Run the learning environments benchmark and exit
+	const char* golden = NULL;				// --golden <file>: Render a replay offscreen, compare frames with golden images and exit
+	const char* golden_dir = "golden";		// --golden-dir <dir>: Golden images folder
+	int golden_every = 5*SIM_TICK_RATE;		// --golden-every <ticks>: Ticks between frames compared
+	int golden_tolerance = 2;				// --golden-tolerance <levels>: Channel difference still matching
+	bool golden_update = false;				// --golden-update: Write the golden images instead of comparing
+	bool golden_target = false;				// --golden-target: Render to a target texture of a hidden window, not with the software renderer
+	const char* capture = NULL;				// --capture <file>: Record the frames drawn as a .y4m video, or PNG files in a folder
+	const char* bench_renderers = NULL;		// --bench-renderers <file>: Draw a replay with every render driver, print frame times and exit
+	int fps = PACING_DISPLAY;				// --fps <n|display|unlimited>: Frame rate target, vsync paces frames by default
+	bool governor = false;					// --governor: Lower resolution and effects to hold the frame rate target
 };
 
-// Global game state variable
+// Global game state variables
+SimState sim;
 GlobalState state;
-int Contador = 0;
+Resources resources;
+GameOptions options = {};
+TripleBuffer<RenderSnapshot> snapshots;
+Replay replay;
+
+// Netplay, the second session only runs with --netplay-loopback
+NetTransport transports[2];
+RollbackSession sessions[2];
+SimState peer_sim;						// Loopback peer state, never drawn
 
 // Functions Declarations
 // Some helpful functions to draw basic shapes
@@ -126,6 +251,164 @@ static void Spawn(int x, int y, int width, int height, SDL_Color color);
 static void DrawLine(int x1, int y1, int x2, int y2, SDL_Color color);
 static void DrawCircle(int x, int y, int radius, SDL_Color color);
 
+static const char* texture_files[TEXTURE_COUNT] =
+{
+	"Assets/Definitivisimo.png",
+	"Assets/ship.png",
+	"Assets/ship.png",
+	"Assets/shot.png",
+	"Assets/Game_Over.png",
+	"Assets/Play_Game.png"
+};
+
+static void LoadTexture(TextureId id)
+{
+	SDL_Surface* surface = IMG_Load(texture_files[id]);
+
+	if (surface == NULL)
+	{
+		printf("WARNING: Unable to load %s! SDL_image Error: %s\n", texture_files[id], IMG_GetError());
+		return;
+	}
+
+	resources.textures[id] = SDL_CreateTextureFromSurface(resources.renderer, surface);
+	SDL_FreeSurface(surface);
+}
+
+static void FreeTexture(TextureId id)
+{
+	if (resources.textures[id] != NULL) SDL_DestroyTexture(resources.textures[id]);
+	resources.textures[id] = NULL;
+}
+
+static void PushDraw(DrawList* list, TextureId texture, SDL_Rect rec)
+{
+	if (list->count == MAX_DRAW_COMMANDS) return;
+
+	list->commands[list->count].texture = texture;
+	list->commands[list->count].rec = rec;
+	list->count++;
+}
+
+static void TitleViewEnter() { LoadTexture(TEXTURE_PLAYGAME); }
+static void TitleViewExit() { FreeTexture(TEXTURE_PLAYGAME); }
+
+static void DrawTitle(const SimState* sim, DrawList* list)
+{
+	SDL_Rect rec = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	PushDraw(list, TEXTURE_PLAYGAME, rec);
+}
+
+static void GameplayViewEnter()
+{
+	LoadTexture(TEXTURE_BACKGROUND);
+	LoadTexture(TEXTURE_SHIP);
+	LoadTexture(TEXTURE_SHIP2);
+	LoadTexture(TEXTURE_SHOT);
+
+	if (resources.textures[TEXTURE_SHIP2] != NULL) SDL_SetTextureColorMod(resources.textures[TEXTURE_SHIP2], 255, 140, 120);
+
+	// Scroll wraps at a fixed height, see Game.h
+	int width = 0, height = 0;
+	SDL_QueryTexture(resources.textures[TEXTURE_BACKGROUND], NULL, NULL, &width, &height);
+	if ((width != BACKGROUND_WIDTH) || (height != BACKGROUND_HEIGHT)) printf("WARNING: Background is %ix%i, expected %ix%i\n", width, height, BACKGROUND_WIDTH, BACKGROUND_HEIGHT);
+}
+
+static void GameplayViewExit()
+{
+	FreeTexture(TEXTURE_BACKGROUND);
+	FreeTexture(TEXTURE_SHIP);
+	FreeTexture(TEXTURE_SHIP2);
+	FreeTexture(TEXTURE_SHOT);
+}
+
+static void DrawGameplay(const SimState* sim, DrawList* list)
+{
+	// Draw background texture (two times for scrolling effect)
+	// NOTE: rec rectangle is being reused for next draws
+	SDL_Rect rec = { 0, -sim->scroll, BACKGROUND_WIDTH, BACKGROUND_HEIGHT };
+	PushDraw(list, TEXTURE_BACKGROUND, rec);
+	rec.y += BACKGROUND_HEIGHT;
+	PushDraw(list, TEXTURE_BACKGROUND, rec);
+
+	// Draw ship rectangle
+	//DrawRectangle(state.ship_x, state.ship_y, 250, 100, { 255, 0, 0, 255 });
+
+	// Draw ship textures, one per player still alive
+	rec.y = sim->ship_y; rec.w = SHIP_SIZE; rec.h = SHIP_SIZE;
+	for (int p = 0; p < sim->players; ++p)
+	{
+		if ((sim->ships_alive & (1u << p)) == 0) continue;
+
+		rec.x = sim->ship_x[p];
+		PushDraw(list, (p == 0)? TEXTURE_SHIP : TEXTURE_SHIP2, rec);
+	}
+
+	// L2: DONE 9: Draw active shots
+	rec.w = SHOT_DRAW_WIDTH; rec.h = SHOT_DRAW_HEIGHT;
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((sim->alive & (1u << i)) == 0) continue;
+
+		//DrawRectangle(sim->shot_x[i], sim->shot_y[i], 50, 20, { 0, 250, 0, 255 });
+		rec.x = sim->shot_x[i]; rec.y = sim->shot_y[i];
+		PushDraw(list, TEXTURE_SHOT, rec);
+	}
+}
+
+static void EndingViewEnter() { LoadTexture(TEXTURE_GAMEOVER); }
+static void EndingViewExit() { FreeTexture(TEXTURE_GAMEOVER); }
+
+static void DrawEnding(const SimState* sim, DrawList* list)
+{
+	SDL_Rect rec = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	PushDraw(list, TEXTURE_GAMEOVER, rec);
+}
+
+// Indexed by GameScreen
+static const ScreenView screen_views[SCREEN_COUNT] =
+{
+	{ TitleViewEnter, TitleViewExit, DrawTitle },
+	{ GameplayViewEnter, GameplayViewExit, DrawGameplay },
+	{ EndingViewEnter, EndingViewExit, DrawEnding }
+};
+
+// Release the shown screen textures and load the new screen ones
+// WARNING: Main thread only
+static void ShowScreen(GameScreen screen)
+{
+	screen_views[state.shown_screen].exit();
+	state.shown_screen = screen;
+	screen_views[screen].enter();
+
+	if (screen == TITLE) state.resize_audio = true;
+}
+
+// Open the netplay transports and sessions, the simulation starts once peers connect
+static bool StartNetplay()
+{
+	bool opened = false;
+
+	if (options.netplay == NETPLAY_LOOPBACK) opened = OpenLoopbackTransports(&transports[0], &transports[1]);
+	else opened = OpenUdpTransport(&transports[0], (options.netplay == NETPLAY_JOIN)? options.net_host : NULL, options.net_port);
+
+	if (!opened) return false;
+
+	int count = (options.netplay == NETPLAY_LOOPBACK)? 2 : 1;
+	for (int i = 0; i < count; ++i)
+	{
+		SetTransportConditions(&transports[i], options.net_latency, options.net_loss);
+		InitRollback(&sessions[i], &transports[i], (options.netplay == NETPLAY_JOIN)? 1 : i, options.seed);
+	}
+
+	// Peers may go back in time on their own, none of these can follow
+	if ((options.record != NULL) || (options.replay != NULL)) printf("WARNING: Replays are not available in netplay\n");
+	options.record = NULL;
+	options.replay = NULL;
+
+	return true;
+}
+
 // Functions Declarations and Definition
 // -------------------------------------------------------------------------
 void Start()
@@ -138,215 +421,238 @@ void Start()
 	//if (SDL_InitSubSystem(SDL_INIT_EVENTS) < 0) printf("SDL_EVENTS could not be initialized! SDL_Error: %s\n", SDL_GetError());
 
 	// Init window
-	state.window = SDL_CreateWindow("2021: Space Odyssey", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	state.surface = SDL_GetWindowSurface(state.window);
+	resources.window = SDL_CreateWindow("2021: Space Odyssey", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+	resources.surface = SDL_GetWindowSurface(resources.window);
+
+	// Init renderer, vsync only paces frames at the display rate, other targets use the frame limiter
+	Uint32 vsync = (options.fps == PACING_DISPLAY)? SDL_RENDERER_PRESENTVSYNC : 0;
+	Uint32 targets = options.governor? SDL_RENDERER_TARGETTEXTURE : 0;
+	resources.renderer = SDL_CreateRenderer(resources.window, -1, SDL_RENDERER_ACCELERATED | vsync | targets);
+	SDL_SetRenderDrawColor(resources.renderer, 100, 149, 237, 255);		// Default clear color: Cornflower blue
+
+	// Governed frames are drawn at a part of the internal target, then upscaled to the window
+	if (options.governor)
+	{
+		resources.target = SDL_CreateTexture(resources.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+		if (resources.target == NULL) printf("WARNING: Unable to create the internal render target, resolution stays fixed! SDL Error: %s\n", SDL_GetError());
+		options.governor = (resources.target != NULL);
+	}
 
-	// Init renderer
-	state.renderer = SDL_CreateRenderer(state.window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	SDL_SetRenderDrawColor(state.renderer, 100, 149, 237, 255);		// Default clear color: Cornflower blue
+	// Video capture reads back what the renderer drew, the writer thread converts and saves it
+	if ((options.capture != NULL) && !StartCapture(options.capture, SCREEN_WIDTH, SCREEN_HEIGHT)) options.capture = NULL;
 
 	// L2: DONE 1: Init input variables (keyboard, mouse_buttons)
-	state.keyboard = (KeyState*)calloc(sizeof(KeyState) * MAX_KEYBOARD_KEYS, 1);
 	for (int i = 0; i < MAX_MOUSE_BUTTONS; i++) state.mouse_buttons[i] = KEY_IDLE;
+	InitInput();
+	InitLatency(options.latency);
 
 	// L2: DONE 2: Init input gamepad 
 	// Check SDL_NumJoysticks() and SDL_JoystickOpen()
 	if (SDL_NumJoysticks() < 1) printf("WARNING: No joysticks connected!\n");
 	else
 	{
-		state.gamepad = SDL_JoystickOpen(0);
-		if (state.gamepad == NULL) printf("WARNING: Unable to open game controller! SDL Error: %s\n", SDL_GetError());
+		resources.gamepad = SDL_JoystickOpen(0);
+		if (resources.gamepad == NULL) printf("WARNING: Unable to open game controller! SDL Error: %s\n", SDL_GetError());
 	}
 
-	// Init image system and load textures
+	// Init image system and load first screen textures
 	IMG_Init(IMG_INIT_PNG);
-	state.background = SDL_CreateTextureFromSurface(state.renderer, IMG_Load("Assets/Definitivisimo.png"));
-	state.ship = SDL_CreateTextureFromSurface(state.renderer, IMG_Load("Assets/ship.png"));
-	state.shot = SDL_CreateTextureFromSurface(state.renderer, IMG_Load("Assets/shot.png"));
-	state.gameover = SDL_CreateTextureFromSurface(state.renderer, IMG_Load("Assets/Game_Over.png"));
-	state.playgame = SDL_CreateTextureFromSurface(state.renderer, IMG_Load("Assets/Play_Game.png"));
-	SDL_QueryTexture(state.background, NULL, NULL, &state.background_width, &state.background_height);
+	state.shown_screen = TITLE;
+	screen_views[TITLE].enter();
 
 	// L4: TODO 1: Init audio system and load music/fx
 	// EXTRA: Handle the case the sound can not be loaded!
 	Mix_Init(MIX_INIT_OGG);
-	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024);
-	state.music = Mix_LoadMUS("Assets/Music.ogg");
-	state.ending = Mix_LoadMUS("Assets/final.ogg");
+	OpenAudio(44100, options.audio_buffer, options.custom_mixer, options.adaptive_audio);
+	resources.music = Mix_LoadMUS("Assets/Music.ogg");
+	resources.ending = Mix_LoadMUS("Assets/final.ogg");
 	// L4: TODO 2: Start playing loaded music
-	Mix_PlayMusic(state.music, -1);
+	// NOTE: Screens start and stop music when entered and left, see Game.cpp
+	//Mix_PlayMusic(resources.music, -1);
 
 
+	// Init job workers, used by the simulation
+	InitJobs(options.jobs);
+
 	// Init game variables
-	state.ship_x = SCREEN_WIDTH / 2;
-	state.ship_y = SCREEN_HEIGHT / 1.3;
-	state.scroll = 0;
-	state.last_shot = 0;
-	
-	
-	state.ship_w = 64;
-	state.ship_h = 64;
-
-	srand(time(NULL));
-	if (state.last_shot == MAX_SHIP_SHOTS) state.last_shot = 0;
+	// NOTE: Seed 0 would stick the generator at 0
+	if (options.seed == 0) options.seed = (Uint32)time(NULL);
+	if (options.seed == 0) options.seed = 1;
+	InitSim(&sim, options.seed, options.players);
 
-	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	// Spectators only draw what the stream sends, nothing is simulated here
+	if (options.spectate_host != NULL)
 	{
+		if (StartSpectating(options.spectate_host, options.spectate_port))
+		{
+			options.netplay = NETPLAY_OFF;
+			options.record = NULL;
+			options.replay = NULL;
+		}
+		else
+		{
+			printf("WARNING: Unable to watch %s:%i, playing instead\n", options.spectate_host, options.spectate_port);
+			options.spectate_host = NULL;
+		}
+	}
 
+	if ((options.netplay != NETPLAY_OFF) && !StartNetplay())
+	{
+		printf("WARNING: Netplay unavailable, playing alone\n");
+		options.netplay = NETPLAY_OFF;
+	}
 
+	// Replays start from their own state, at any tick
+	if (options.replay != NULL)
+	{
+		if (OpenReplay(&replay, options.replay))
+		{
+			Uint32 start = SDL_max(options.replay_start, GetReplayFirstTick(&replay));
+			state.replaying = SeekReplay(&replay, start, &sim);
 
+			if (state.replaying) options.seed = replay.seed;
+			else printf("WARNING: Replay %s can't start from tick %u, it has ticks %u to %u\n", options.replay, start, GetReplayFirstTick(&replay), GetReplayEndTick(&replay));
+		}
+	}
+
+	if (options.record != NULL) BeginReplayRecording(options.record, options.seed);
 
-		srand(time(NULL));
-		if (state.last_shot == MAX_SHIP_SHOTS) state.last_shot = 0;
-
-		int a;
-
-		a = rand() % 5;
-
-		switch (a) {
-		case 0:
-
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 286;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 406;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 526;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 646;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-
-			break;
-
-		case 1:
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 166;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 406;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 526;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 646;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-
-			break;
-		case 2:
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 166;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 286;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 526;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 646;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-			break;
-		case 3:
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 166;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 286;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 406;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 646;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-			break;
-		case 4:
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 166;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 286;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 406;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-			state.shots[state.last_shot].alive = true;
-			state.shots[state.last_shot].x = 526;
-			state.shots[state.last_shot].y = -20;
-			state.last_shot++;
-
-
-
-			break;
+	// Bots press the keys of their player, in netplay the local ship is player 2 when joining
+	for (int p = 0; (p < MAX_PLAYERS) && (options.spectate_host == NULL); ++p)
+	{
+		if (options.bots[p] == BOT_OFF) continue;
 
+		bool remote_netplay = (options.netplay == NETPLAY_HOST) || (options.netplay == NETPLAY_JOIN);
 
+		if ((p == 1) && (remote_netplay || ((options.netplay == NETPLAY_OFF) && (options.players < 2))))
+		{
+			printf("WARNING: --bot2 needs a second player on this keyboard (--versus or --netplay-loopback)\n");
+			continue;
 		}
 
+		InitBot((options.netplay == NETPLAY_JOIN)? 1 : p, p, options.bots[p], options.seed + p);
+	}
+
+	if ((options.broadcast_port != 0) && !StartBroadcast(options.broadcast_port)) printf("WARNING: Broadcast unavailable\n");
 
-	}Contador++;
+	InitRewind();
+	RecordRewind(&sim);
 
 }
 
 // ----------------------------------------------------------------
 void Finish()
 {
-	// L4: TODO 3: Unload music/fx and deinitialize audio system
-	Mix_FreeMusic(state.music);
-	Mix_CloseAudio();
+	EndReplayRecording();
+	CloseReplay(&replay);
+
+	for (int i = 0; (options.netplay != NETPLAY_OFF) && (i < 2); ++i)
+	{
+		if (!sessions[i].connected) continue;
+
+		RollbackStats net_stats = GetRollbackStats(&sessions[i]);
+		printf("Netplay: player %i, %i ticks, %i stalls, %i rollbacks, %i ticks simulated again (%i max), %.3f ms average rollback, %.3f ms max\n",
+			sessions[i].player + 1, net_stats.ticks, net_stats.stalls, net_stats.rollbacks, net_stats.resimulated, net_stats.max_resimulated, net_stats.avg_rollback_ms, net_stats.max_rollback_ms);
+		printf("Netplay: player %i, %i packets sent, %i received, %i dropped, %s\n", sessions[i].player + 1,
+			net_stats.packets_sent, net_stats.packets_received, net_stats.packets_dropped, net_stats.desync? "desynced" : "in sync");
+	}
+	for (int i = 0; i < 2; ++i) CloseTransport(&transports[i]);
+
+	for (int p = 0; p < MAX_PLAYERS; ++p)
+	{
+		if (options.bots[p] == BOT_OFF) continue;
+
+		BotStats bot_stats = GetBotStats((options.netplay == NETPLAY_JOIN)? 1 : p);
+		printf("Bot %i: %i rounds, %.0f ticks average round, %i ticks best round, %i wins, %i mistakes\n",
+			p + 1, bot_stats.rounds, bot_stats.avg_round_ticks, bot_stats.best_round_ticks, bot_stats.wins, bot_stats.mistakes);
+	}
+
+	if (options.broadcast_port != 0)
+	{
+		BroadcastStats broadcast_stats = GetBroadcastStats();
+		printf("Broadcast: %i ticks, %.0f bytes/s per spectator, %i keyframes, %i spectators peak, %i dropped\n",
+			broadcast_stats.ticks, broadcast_stats.bytes_per_second, broadcast_stats.keyframes, broadcast_stats.peak_spectators, broadcast_stats.dropped);
+		StopBroadcast();
+	}
+
+	if (options.spectate_host != NULL)
+	{
+		BroadcastStats spectate_stats = GetSpectatingStats();
+		printf("Spectating: %i ticks, %i keyframes, %llu bytes, %.0f bytes/s\n",
+			spectate_stats.ticks, spectate_stats.keyframes, (unsigned long long)spectate_stats.bytes, spectate_stats.bytes_per_second);
+		StopSpectating();
+	}
+
+	PacingStats pacing_stats = GetPacingStats();
+	printf("Pacing: %i frames, %.2f ms average, %.2f ms max, %i missed deadlines, %i stutters, %.1f%% waiting (%.1f%% spinning)\n",
+		pacing_stats.frames, pacing_stats.avg_frame_ms, pacing_stats.max_frame_ms, pacing_stats.missed, pacing_stats.stutters,
+		(pacing_stats.frames > 0)? pacing_stats.wait_ms*100.0f/(pacing_stats.avg_frame_ms*pacing_stats.frames) : 0.0f,
+		(pacing_stats.frames > 0)? pacing_stats.spin_ms*100.0f/(pacing_stats.avg_frame_ms*pacing_stats.frames) : 0.0f);
+
+	if (options.governor)
+	{
+		GovernorStats governor_stats = GetGovernorStats();
+		printf("Governor: %.0f%% average scale, %.0f%% lowest, %i steps down, %i steps up, %i undone\n",
+			governor_stats.avg_scale*100.0f, governor_stats.min_scale*100.0f, governor_stats.lowered, governor_stats.raised, governor_stats.failed_raises);
+	}
+
+	if (options.capture != NULL)
+	{
+		StopCapture();
+		CaptureStats capture_stats = GetCaptureStats();
+		printf("Capture: %i frames written to %s, %i dropped, %.2f ms average write\n",
+			capture_stats.written, options.capture, capture_stats.dropped, capture_stats.avg_write_ms);
+	}
+
+	PrintLatencyReport();
+	PrintFrameGraphReport();
+	if (options.frame_trace != NULL) WriteFrameTrace(options.frame_trace);
+	CloseFrameGraph();
+	CloseJobs();
+
+	double sim_ms = (state.ticks_run > 0)? state.sim_time*1000.0/SDL_GetPerformanceFrequency()/state.ticks_run : 0.0;
+	printf("Simulation: %u ticks, %.3f ms average tick, seed %u, hash %08X at tick %u, %i audio commands dropped\n",
+		state.ticks_run, sim_ms, options.seed, state.sim_hash, sim.tick, state.audio.dropped);
+	RewindStats rewind_stats = GetRewindStats();
+	printf("Rewind: %i ticks kept in %i bytes, %.1f bytes average delta (%i bytes state), %i rewinds\n",
+		rewind_stats.ticks, rewind_stats.bytes, rewind_stats.avg_delta, (int)sizeof(SimState), rewind_stats.rewinds);
+	JobStats job_stats = GetJobStats();
+	printf("Jobs: %i workers, %i jobs, %i stolen\n", job_stats.workers, job_stats.jobs, job_stats.stolen);
+
+	// L4: DONE 3: Unload music/fx and deinitialize audio system
+	SoundFxStats fx_stats = GetSoundFxStats();
+	AudioStats audio_stats = GetAudioStats();
+	printf("Sound fx: %i played, %i stolen, %i rate limited, %i rejected\n", fx_stats.played, fx_stats.stolen, fx_stats.rate_limited, fx_stats.rejected);
+	InputStats input_stats = GetInputStats();
+	printf("Input: %i key edges, %i deferred, %i dropped, %.2f ms average delay, %.2f ms max delay\n",
+		input_stats.events, input_stats.deferred, input_stats.dropped, input_stats.avg_delay_ms, input_stats.max_delay_ms);
+	printf("Audio: %i samples buffer, %i resizes, %i callbacks, %i underruns, %.2f ms max load, %.2f ms max post-mix\n",
+		audio_stats.buffer, audio_stats.resizes, audio_stats.callbacks, audio_stats.underruns, audio_stats.max_load_ms, audio_stats.max_postmix_ms);
+	Mix_FreeMusic(resources.music);
+	Mix_FreeMusic(resources.ending);
+	CloseAudio();
 	Mix_Quit();
 
 	// Unload textures and deinitialize image system
-	SDL_DestroyTexture(state.background);
-	SDL_DestroyTexture(state.ship);
+	screen_views[state.shown_screen].exit();
 	IMG_Quit();
 
 	// L2: DONE 3: Close game controller
-	SDL_JoystickClose(state.gamepad);
-	state.gamepad = NULL;
+	SDL_JoystickClose(resources.gamepad);
+	resources.gamepad = NULL;
 
 	// Deinitialize input events system
+	CloseInput();
 	//SDL_QuitSubSystem(SDL_INIT_EVENTS);
 
 	// Deinitialize renderer and window
 	// WARNING: Renderer should be deinitialized before window
-	SDL_DestroyRenderer(state.renderer);
-	SDL_DestroyWindow(state.window);
+	if (resources.target != NULL) SDL_DestroyTexture(resources.target);
+	SDL_DestroyRenderer(resources.renderer);
+	SDL_DestroyWindow(resources.window);
 
 	// Deinitialize SDL internal global state
 	SDL_Quit();
-
-	// Free any game allocated memory
-	free(state.keyboard);
 }
 
 // ----------------------------------------------------------------
@@ -426,27 +732,22 @@ bool CheckInput()
 		}
 	}
 
-	const Uint8* keys = SDL_GetKeyboardState(NULL);
-
 	// L2: DONE 5: Update keyboard keys state
-	// Consider previous keys states for KEY_DOWN and KEY_UP
-	for (int i = 0; i < MAX_KEYBOARD_KEYS; ++i)
-	{
-		// A value of 1 means that the key is pressed and a value of 0 means that it is not
-		if (keys[i] == 1)
-		{
-			if (state.keyboard[i] == KEY_IDLE) state.keyboard[i] = KEY_DOWN;
-			else state.keyboard[i] = KEY_REPEAT;
-		}
-		else
-		{
-			if (state.keyboard[i] == KEY_REPEAT || state.keyboard[i] == KEY_DOWN) state.keyboard[i] = KEY_UP;
-			else state.keyboard[i] = KEY_IDLE;
-		}
-	}
+	// Packed bitsets diffed against previous frame, see Input.cpp
+	UpdateKeyboard();
 
 	// L2: DONE 6: Check ESCAPE key pressed to finish the game
-	if (state.keyboard[SDL_SCANCODE_ESCAPE] == KEY_DOWN) return false;
+	if (GetFrameAction(ACTION_QUIT) == KEY_DOWN) return false;
+
+	// Debug keys, the simulation applies them before its next tick
+	// NOTE: Netplay peers can't follow a local state change, spectators have no state of their own
+	state.sim_requests = 0;
+	if ((options.netplay == NETPLAY_OFF) && (options.spectate_host == NULL))
+	{
+		if (GetFrameKey(SDL_SCANCODE_F5) == KEY_DOWN) state.sim_requests |= SIM_REQUEST_SAVE;
+		if (GetFrameKey(SDL_SCANCODE_F9) == KEY_DOWN) state.sim_requests |= SIM_REQUEST_LOAD;
+		if (GetFrameKey(SDL_SCANCODE_BACKSPACE) == KEY_DOWN) state.sim_requests |= SIM_REQUEST_REWIND;
+	}
 
 	// Check QUIT window event to finish the game
 	if (state.window_events[WE_QUIT] == true) return false;
@@ -455,267 +756,744 @@ bool CheckInput()
 }
 
 // ----------------------------------------------------------------
-void MoveStuff()
+// Apply the buffer size suggested by the audio callback telemetry
+// NOTE: Music must be reloaded, so only call it where no music is needed
+// WARNING: Main thread only, reopening the device can take tens of milliseconds
+void UpdateAudioBuffer()
 {
-	switch (state.currentScreen)
+	int buffer = SuggestAudioBuffer();
+	if (buffer == 0) return;
+
+	Mix_HaltMusic();
+	Mix_FreeMusic(resources.music);
+	Mix_FreeMusic(resources.ending);
+
+	ResizeAudioBuffer(buffer);
+
+	resources.music = Mix_LoadMUS("Assets/Music.ogg");
+	resources.ending = Mix_LoadMUS("Assets/final.ogg");
+}
+
+// ----------------------------------------------------------------
+// Copy what drawing needs into the snapshot being written and publish it
+void PublishSnapshot()
+{
+	RenderSnapshot* snapshot = snapshots.Write();
+
+	snapshot->sim = sim;
+
+	// Input edge (if any) this snapshot shows and no presented one did yet
+	snapshot->latency_tag = GetReflectedTag();
+
+	snapshots.Publish();
+}
+
+// ----------------------------------------------------------------
+// Connect, then advance the local session, and the loopback peer with the player 2 keys
+// Returns false while connecting or stalled, waiting for the peer actions
+bool NetplayTick(Uint8 actions, Uint32* reflected)
+{
+	int count = (options.netplay == NETPLAY_LOOPBACK)? 2 : 1;
+
+	*reflected = 0;
+
+	if (!state.net_connected)
 	{
-	case TITLE:
+		bool connected = true;
+		for (int i = 0; i < count; ++i) connected = ConnectRollback(&sessions[i]) && connected;
+		if (!connected) return false;
+
+		// Both peers start from the host seed
+		options.seed = sessions[0].seed;
+		InitSim(&sim, options.seed, MAX_PLAYERS);
+		peer_sim = sim;
+		InitRewind();
+		state.net_connected = true;
+
+		printf("Netplay: connected as player %i, seed %u\n", sessions[0].player + 1, options.seed);
+	}
+
+	if (count == 2)
 	{
-		Mix_FadeOutMusic(100);
-		if (state.keyboard[SDL_SCANCODE_RETURN] == KEY_DOWN) {
-			state.currentScreen = GAMEPLAY;
-			Mix_PlayMusic(state.music, -1);
+		Uint32 peer_reflected = 0;
+		RollbackTick(&sessions[1], &peer_sim, (Uint8)(actions >> PLAYER_ACTION_BITS), NULL, &peer_reflected);
+		*reflected |= peer_reflected << PLAYER_ACTION_BITS;
+	}
+
+	Uint32 local_reflected = 0;
+	bool advanced = RollbackTick(&sessions[0], &sim, actions, &state.audio, &local_reflected);
+	*reflected |= local_reflected;
+
+	return advanced;
+}
+
+// ----------------------------------------------------------------
+void SimulationTick()
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	// Simulation reads actions from the timestamped events queue, not from the frame keyboard
+	// NOTE: Bots queue their keys there too, seeing the state before the tick
+	UpdateBots(&sim, start);
+	UpdateInputTick(start);
+
+	// Spectators draw the broadcast, the simulation does not run
+	if (options.spectate_host != NULL)
+	{
+		if (!UpdateSpectating(&sim) && !state.broadcast_ended)
+		{
+			printf("Broadcast ended at tick %u\n", sim.tick);
+			state.broadcast_ended = true;
 		}
-	} break;
-	case GAMEPLAY:
+
+		PublishSnapshot();
+		return;
+	}
+
+	Uint8 actions = (Uint8)GetTickActions();
+
+	// Replays drive the simulation up to their last tick, then the keyboard takes over
+	if (state.replaying && !GetReplayActions(&replay, sim.tick, &actions))
 	{
-		if ((state.ship_x >= 155) && (state.ship_x <= 680)) {
-		if (state.keyboard[SDL_SCANCODE_LEFT] == KEY_REPEAT) state.ship_x -= SHIP_SPEED;
-		else if (state.keyboard[SDL_SCANCODE_RIGHT] == KEY_REPEAT) state.ship_x += SHIP_SPEED;
-		//if (state.keyboard[SDL_SCANCODE_UP] == KEY_REPEAT) state.ship_y -= SHIP_SPEED;
-		//else if (state.keyboard[SDL_SCANCODE_DOWN] == KEY_REPEAT) state.ship_y += SHIP_SPEED;
+		printf("Replay finished at tick %u\n", sim.tick);
+		state.replaying = false;
 	}
-	else if (state.ship_x < 155 && state.keyboard[SDL_SCANCODE_RIGHT] == KEY_REPEAT && state.keyboard[SDL_SCANCODE_LEFT] == KEY_IDLE) {
-		state.ship_x = 155;
+
+	SimState before = sim;
+	Uint32 expected_hash = 0;
+	bool check_hash = state.replaying && GetReplayHash(&replay, sim.tick, &expected_hash);
+
+	Uint32 reflected = 0;
+
+	if (options.netplay == NETPLAY_OFF) reflected = MoveStuff(&sim, actions, &state.audio);
+	else if (!NetplayTick(actions, &reflected))
+	{
+		state.sim_time += SDL_GetPerformanceCounter() - start;
+		return;
 	}
-	else if (state.ship_x > 155 && state.keyboard[SDL_SCANCODE_LEFT] == KEY_REPEAT && state.keyboard[SDL_SCANCODE_RIGHT] == KEY_IDLE) {
-		state.ship_x = 680;
+
+	for (int a = 0; a < ACTION_COUNT; ++a) if (reflected & ACTION_BIT(a)) MarkInputReflected(a);
+
+	state.sim_hash = HashSim(&sim);
+	RecordReplayTick(&before, actions, state.sim_hash);
+
+	if (check_hash && (state.sim_hash != expected_hash) && !state.replay_desync)
+	{
+		printf("WARNING: Replay desync at tick %u, run it with --check for details\n", before.tick);
+		state.replay_desync = true;
 	}
 
-		for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	RecordRewind(&sim);
+	BroadcastTick(&sim);
+
+	state.ticks_run++;
+	state.sim_time += SDL_GetPerformanceCounter() - start;
+
+	PublishSnapshot();
+}
+
+// ----------------------------------------------------------------
+// Frame task: pump events and keep the frame keyboard up to date
+void PollInput()
+{
+	state.running = CheckInput();
+
+	// NOTE: First task of the frame, no audio task runs yet; the device belongs to the main thread
+	if (state.resize_audio) UpdateAudioBuffer();
+	state.resize_audio = false;
+}
+
+// ----------------------------------------------------------------
+// Save, load or rewind the simulation state, as requested by debug keys
+void ApplySimRequests()
+{
+	if (state.sim_requests & SIM_REQUEST_SAVE)
+	{
+		if (SaveSimSnapshot(&sim, options.snapshot)) printf("Snapshot of tick %u saved to %s\n", sim.tick, options.snapshot);
+	}
+
+	if (state.sim_requests & SIM_REQUEST_LOAD)
+	{
+		// Loaded ticks have no history, start recording from there
+		if (LoadSimSnapshot(&sim, options.snapshot))
 		{
-			if (state.shots[i].alive)
-			{
-				if (state.shots[i].y < SCREEN_HEIGHT) { state.shots[i].y += SHOT_SPEED; }
-				else if (state.shots[i].y > SCREEN_HEIGHT + 100) { state.shots[i].alive = false; }
-				else {
-
-
-					srand(time(NULL));
-					if (state.last_shot == MAX_SHIP_SHOTS) state.last_shot = 0;
-
-					int a;
-
-					a = rand() % 5;
-
-					switch (a) {
-					case 0:
-
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 286;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 406;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 526;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 646;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-
-
-						break;
-
-					case 1:
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 166;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 406;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 526;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 646;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-
-
-						break;
-					case 2:
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 166;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 286;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 526;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 646;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-
-						break;
-					case 3:
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 166;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 286;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 406;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 646;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-
-						break;
-					case 4:
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 166;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 286;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 406;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						state.shots[state.last_shot].alive = true;
-						state.shots[state.last_shot].x = 526;
-						state.shots[state.last_shot].y = -20;
-						state.last_shot++;
-						break;
-
-
-
-
-
-
-					}
-				}
-			}
-			if (state.ship_x< state.shots[i].x + state.shot_w && state.ship_x + state.ship_w>state.shots[i].x && state.ship_y<state.shots[i].y + state.shot_h && state.ship_h + state.ship_y>state.shots[i].y)
-			{
-				state.currentScreen = ENDING;
-				Mix_FadeOutMusic(100);
-				Mix_PlayMusic(state.ending, -1);
-			}
+			InitRewind();
+			RecordRewind(&sim);
+			PublishSnapshot();
 		}
+	}
 
+	if (state.sim_requests & SIM_REQUEST_REWIND)
+	{
+		Uint32 tick = (sim.tick > SIM_TICK_RATE)? sim.tick - SIM_TICK_RATE : 0;
+		if (tick < GetRewindOldestTick()) tick = GetRewindOldestTick();
+
+		if (RewindTo(tick, &sim)) PublishSnapshot();
+	}
+}
 
+// ----------------------------------------------------------------
+// Frame task: run the simulation ticks due by now, at a fixed rate
+void UpdateSim()
+{
+	Uint64 period = SDL_GetPerformanceFrequency()/SIM_TICK_RATE;
+	Uint64 now = SDL_GetPerformanceCounter();
 
-		// L4: TODO 4: Play sound fx_shoot
-		if (state.keyboard[SDL_SCANCODE_RETURN] == KEY_DOWN) {
-			
-		}
-	}break;
-	// Update active shots
+	if (state.sim_requests != 0) ApplySimRequests();
 
+	for (int ticks = 0; (state.next_tick <= now) && (ticks < MAX_TICKS_PER_FRAME); ++ticks)
+	{
+		SimulationTick();
+		state.next_tick += period;
+	}
 
+	// After a long stall (debugger, window drag) don't try to catch up
+	if (state.next_tick <= now) state.next_tick = now + period;
+}
 
-	case ENDING:
+// ----------------------------------------------------------------
+// Frame task: play what the simulation asked for since last frame
+void SubmitAudio()
+{
+	for (int i = 0; i < state.audio.count; ++i)
 	{
-		if (state.keyboard[SDL_SCANCODE_RETURN] == KEY_DOWN) {
-			state.currentScreen = TITLE;
+		AudioCommand* command = &state.audio.commands[i];
 
+		switch (command->type)
+		{
+		case AUDIO_BEGIN_TICK: BeginSoundFxTick(command->value); break;
+		case AUDIO_PLAY_FX: PlaySoundFx((SoundFx)command->value, command->x); break;
+		case AUDIO_PLAY_MUSIC: Mix_PlayMusic((command->value == MUSIC_ENDING)? resources.ending : resources.music, -1); break;
+		case AUDIO_FADE_OUT_MUSIC: Mix_FadeOutMusic(command->value); break;
+		default: break;
 		}
-	} break;
-	default: break;
 	}
+
+	state.audio.count = 0;
 }
 
+// List the textures to copy to draw drawn_sim
+static void FillDrawList(const SimState* drawn_sim, Uint64 latency_tag)
+{
+	DrawList* list = &state.draw_list;
 
+	list->tick = drawn_sim->tick;
+	list->screen = (GameScreen)drawn_sim->screen;
+	list->latency_tag = latency_tag;
+	list->count = 0;
 
+	screen_views[list->screen].draw(drawn_sim, list);
+}
+
+// ----------------------------------------------------------------
+// Frame task: turn the latest snapshot into the list of textures to copy
+void BuildDrawList()
+{
+	const RenderSnapshot* snapshot = snapshots.Read();
+
+	FillDrawList(&snapshot->sim, snapshot->latency_tag);
+}
 
 // ----------------------------------------------------------------
-void Draw()
+// Draw the list to the current render target: the window, a target texture or a surface
+void RenderDrawList(const DrawList* list)
 {
 	// Clear screen to Cornflower blue
-	SDL_SetRenderDrawColor(state.renderer, 100, 149, 237, 255);
-	SDL_RenderClear(state.renderer);
+	SDL_SetRenderDrawColor(resources.renderer, 100, 149, 237, 255);
+	SDL_RenderClear(resources.renderer);
+
+	for (int i = 0; i < list->count; ++i) SDL_RenderCopy(resources.renderer, resources.textures[list->commands[i].texture], NULL, &list->commands[i].rec);
+}
+
+// Draw the list at the governor scale into the internal target, then upscale it to the window
+// NOTE: Render scale and viewport are kept per target, the window ones stay untouched
+static void RenderGoverned(const DrawList* list)
+{
+	int eighths = GetGovernorEighths();
+	SDL_Rect drawn = { 0, 0, SCREEN_WIDTH*eighths/8, SCREEN_HEIGHT*eighths/8 };
+
+	SDL_SetRenderTarget(resources.renderer, resources.target);
+	SDL_RenderSetScale(resources.renderer, eighths/8.0f, eighths/8.0f);
+	RenderDrawList(list);
+
+	// Upscale filtering is the only optional effect so far
+	SDL_SetTextureScaleMode(resources.target, (GetGovernorEffects() > 0)? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
+
+	SDL_SetRenderTarget(resources.renderer, NULL);
+	SDL_RenderCopy(resources.renderer, resources.target, &drawn, NULL);
+}
+
+// ----------------------------------------------------------------
+// Frame task: submit the draw list to the renderer
+void Present()
+{
+	const DrawList* list = &state.draw_list;
+
+	// Last edges before the present may wait for vsync, stamp them now
+	PumpInput();
+
+	// Screen textures are loaded and released here, the renderer only works on the main thread
+	if (list->screen != state.shown_screen) ShowScreen(list->screen);
+
+	if (options.governor) RenderGoverned(list);
+	else RenderDrawList(list);
+
+	// One video frame per tick drawn, read back before the present leaves the back buffer undefined
+	if ((options.capture != NULL) && (list->tick != state.drawn_tick)) CaptureFrame(resources.renderer);
+
+	// Finally present framebuffer
+	SDL_RenderPresent(resources.renderer);
+	UpdateGovernor(SDL_GetPerformanceCounter());
+
+	// Same snapshot may be drawn again if the simulation is slower, measure it once
+	if (list->tick != state.drawn_tick) RecordPresent(list->latency_tag);
+	state.drawn_tick = list->tick;
+}
+
+// ----------------------------------------------------------------
+// Frame as a graph: simulation and audio overlap with drawing the last snapshot
+void InitFrame()
+{
+	snapshots.Clear();
+
+	// First snapshot is published before any frame, so there is always one to draw
+	PublishSnapshot();
+	state.drawn_tick = 0;
+	state.next_tick = SDL_GetPerformanceCounter();
+	state.running = true;
+
+	// Vsync intervals are expected to match the display refresh rate
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(resources.window, &mode) != 0) mode.refresh_rate = 0;
+	InitPacing(options.fps, mode.refresh_rate);
+
+	// Governed frames hold the frame rate target, unlimited frames have none
+	double budget_ms = (options.fps > 0)? 1000.0/options.fps : ((options.fps == PACING_DISPLAY) && (mode.refresh_rate > 0))? 1000.0/mode.refresh_rate : 0.0;
+	if (options.governor && (budget_ms == 0.0)) printf("WARNING: --governor needs a frame rate target, resolution stays fixed\n");
+	InitGovernor(options.governor, budget_ms);
+
+	InitFrameGraph();
+	AddFrameTask("PollInput", PollInput, 0, SECTION_EVENTS, TASK_MAIN_THREAD);
+	AddFrameTask("UpdateSim", UpdateSim, SECTION_EVENTS, SECTION_GAME | SECTION_AUDIO_COMMANDS, TASK_ANY_THREAD);
+	AddFrameTask("SubmitAudio", SubmitAudio, 0, SECTION_AUDIO_COMMANDS | SECTION_AUDIO, TASK_ANY_THREAD);
+	AddFrameTask("BuildDrawList", BuildDrawList, 0, SECTION_DRAW_LIST, TASK_ANY_THREAD);
+	AddFrameTask("Present", Present, SECTION_DRAW_LIST, SECTION_RENDERER, TASK_MAIN_THREAD);
+}
+
+// Renderer drawing offscreen, frames are read back from its target
+// Software renderer on the returned surface by default, it needs no display
+static SDL_Surface* OpenOffscreenRenderer()
+{
+	SDL_Surface* canvas = NULL;
+
+	if (options.golden_target)
+	{
+		SDL_Init(SDL_INIT_VIDEO);
+		resources.window = SDL_CreateWindow("2021: Space Odyssey", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+		if (resources.window != NULL) resources.renderer = SDL_CreateRenderer(resources.window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+		if (resources.renderer != NULL) resources.target = SDL_CreateTexture(resources.renderer, GOLDEN_FORMAT, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+		if ((resources.target == NULL) || (SDL_SetRenderTarget(resources.renderer, resources.target) != 0))
+		{
+			printf("WARNING: Unable to render to a target texture! SDL Error: %s\n", SDL_GetError());
+			if (resources.renderer != NULL) SDL_DestroyRenderer(resources.renderer);
+			resources.renderer = NULL;
+		}
+
+		return NULL;
+	}
+
+	canvas = CreateGoldenSurface(SCREEN_WIDTH, SCREEN_HEIGHT);
+	if (canvas != NULL) resources.renderer = SDL_CreateSoftwareRenderer(canvas);
+	if (resources.renderer == NULL) printf("WARNING: Unable to create the software renderer! SDL Error: %s\n", SDL_GetError());
+
+	return canvas;
+}
+
+// ----------------------------------------------------------------
+// Replay a session headless, draw every --golden-every ticks offscreen and
+// compare the frames with the golden images, writing the missing ones
+bool RunGoldenCheck()
+{
+	if (!OpenReplay(&replay, options.golden)) return false;
+
+	IMG_Init(IMG_INIT_PNG);
+
+	SDL_Surface* canvas = OpenOffscreenRenderer();
+	SDL_Surface* frame = CreateGoldenSurface(SCREEN_WIDTH, SCREEN_HEIGHT);
+	SDL_Surface* diff = CreateGoldenSurface(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	Uint32 first = GetReplayFirstTick(&replay);
+	Uint32 end = GetReplayEndTick(&replay);
+	bool ready = (resources.renderer != NULL) && (frame != NULL) && (diff != NULL) && SeekReplay(&replay, first, &sim);
+
+	int compared = 0, differing = 0, missing = 0, written = 0;
+	state.shown_screen = TITLE;
+	if (ready) screen_views[TITLE].enter();
+
+	for (Uint32 tick = first; ready && (tick < end); ++tick)
+	{
+		if (tick%SDL_max(options.golden_every, 1) == 0)
+		{
+			const DrawList* list = &state.draw_list;
+			FillDrawList(&sim, 0);
+			if (list->screen != state.shown_screen) ShowScreen(list->screen);
+
+			RenderDrawList(list);
+			if (!ReadGoldenFrame(resources.renderer, frame)) break;
+
+			char path[GOLDEN_PATH_SIZE];
+			GetGoldenPath(path, options.golden_dir, tick, "");
+			SDL_Surface* golden = options.golden_update? NULL : LoadGolden(path);
+
+			// A frame without its image checks nothing, only updates may write it
+			if (options.golden_update)
+			{
+				if (SaveGolden(frame, path)) written++;
+				else missing++;
+			}
+			else if (golden == NULL)
+			{
+				printf("Golden: no image for tick %u at %s, run with --golden-update to write it\n", tick, path);
+				missing++;
+			}
+			else
+			{
+				GoldenDiff result = CompareGolden(frame, golden, options.golden_tolerance, diff);
+				compared++;
+
+				if (result.differing > 0)
+				{
+					char diff_path[GOLDEN_PATH_SIZE];
+					GetGoldenPath(diff_path, options.golden_dir, tick, ".diff");
+					SaveGolden(diff, diff_path);
+
+					printf("Golden: tick %u differs, %i of %i pixels off by more than %i (max %i), see %s\n",
+						tick, result.differing, result.pixels, options.golden_tolerance, result.max_delta, diff_path);
+					differing++;
+				}
+
+				SDL_FreeSurface(golden);
+			}
+		}
 
-	switch (state.currentScreen)
+		Uint8 actions = 0;
+		GetReplayActions(&replay, tick, &actions);
+		MoveStuff(&sim, actions, NULL);
+	}
+
+	if (ready)
 	{
-	case TITLE:
+		printf("Golden: %s, %i frames compared, %i differ, %i missing, %i images written to %s, %s renderer\n", options.golden,
+			compared, differing, missing, written, options.golden_dir, (resources.target != NULL)? "target texture" : "software");
+
+		screen_views[state.shown_screen].exit();
+	}
+
+	SDL_FreeSurface(diff);
+	SDL_FreeSurface(frame);
+	if (resources.target != NULL) SDL_DestroyTexture(resources.target);
+	if (resources.renderer != NULL) SDL_DestroyRenderer(resources.renderer);
+	if (resources.window != NULL) SDL_DestroyWindow(resources.window);
+	SDL_FreeSurface(canvas);
+	CloseReplay(&replay);
+	IMG_Quit();
+	SDL_Quit();
+
+	return ready && (differing == 0) && (missing == 0) && ((compared > 0) || (written > 0));
+}
+
+// ----------------------------------------------------------------
+// Split host:port, the host name is kept in place
+bool ParseHostPort(char* arg, const char** host, int* port)
+{
+	char* colon = SDL_strrchr(arg, ':');
+
+	if (colon == NULL)
 	{
-		SDL_Rect rec = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
-		SDL_RenderCopy(state.renderer, state.playgame, NULL, &rec);
-	} break;
-	case GAMEPLAY:
+		printf("WARNING: Expected host:port, got %s\n", arg);
+		return false;
+	}
+
+	*colon = '\0';
+	*host = arg;
+	*port = SDL_atoi(colon + 1);
+
+	return true;
+}
+
+static int CompareFrameTimes(const void* a, const void* b)
+{
+	float difference = *(const float*)a - *(const float*)b;
+
+	return (difference > 0.0f) - (difference < 0.0f);
+}
+
+// Draw BENCH_RENDER_FRAMES replay ticks with the renderer in resources, one tick per frame, the replay loops
+// Frame times go to times, presented frame to presented frame
+static void DrawReplayFrames(float* times)
+{
+	Uint32 first = GetReplayFirstTick(&replay);
+	Uint32 end = GetReplayEndTick(&replay);
+
+	SeekReplay(&replay, first, &sim);
+	state.shown_screen = TITLE;
+	screen_views[TITLE].enter();
+
+	Uint64 last = SDL_GetPerformanceCounter();
+
+	for (int i = 0; i < BENCH_RENDER_FRAMES; ++i)
 	{
-		// Draw background and scroll
-		state.scroll -= SCROLL_SPEED;
-		if (state.scroll <= 0)	state.scroll = state.background_height;
+		if (sim.tick >= end) SeekReplay(&replay, first, &sim);
+
+		Uint8 actions = 0;
+		GetReplayActions(&replay, sim.tick, &actions);
+		MoveStuff(&sim, actions, NULL);
+
+		const DrawList* list = &state.draw_list;
+		FillDrawList(&sim, 0);
+		if (list->screen != state.shown_screen) ShowScreen(list->screen);
 
-		// Draw background texture (two times for scrolling effect)
-		// NOTE: rec rectangle is being reused for next draws
-		SDL_Rect rec = { 0, -state.scroll, state.background_width, state.background_height };
-		SDL_RenderCopy(state.renderer, state.background, NULL, &rec);
-		rec.y += state.background_height;
-		SDL_RenderCopy(state.renderer, state.background, NULL, &rec);
+		RenderDrawList(list);
+		SDL_RenderPresent(resources.renderer);
+
+		// Keep the window responsive, some drivers stall presents otherwise
+		SDL_PumpEvents();
+
+		Uint64 now = SDL_GetPerformanceCounter();
+		times[i] = (float)((now - last)*1000.0/SDL_GetPerformanceFrequency());
+		last = now;
+	}
 
-		// Draw ship rectangle
-		//DrawRectangle(state.ship_x, state.ship_y, 250, 100, { 255, 0, 0, 255 });
+	screen_views[state.shown_screen].exit();
+}
+
+// ----------------------------------------------------------------
+// Draw the same replay with every render driver SDL has, vsync off and on, and print the frame times distribution
+// NOTE: The driver is picked through SDL_HINT_RENDER_DRIVER, as a deployment would pick it
+void RunRendererBenchmark()
+{
+	if (!OpenReplay(&replay, options.bench_renderers)) return;
+
+	SDL_Init(SDL_INIT_VIDEO);
+	IMG_Init(IMG_INIT_PNG);
 
-		// Draw ship texture
-		rec.x = state.ship_x; rec.y = state.ship_y; rec.w = 64; rec.h = 64;
-		SDL_RenderCopy(state.renderer, state.ship, NULL, &rec);
+	float* times = (float*)SDL_malloc(BENCH_RENDER_FRAMES*sizeof(float));
 
-		// L2: DONE 9: Draw active shots
-		rec.w = 86; rec.h = 124;
-		for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	printf("Renderers benchmark: %s, %i frames per run, one tick per frame\n", options.bench_renderers, BENCH_RENDER_FRAMES);
+	printf("  %-12s %-6s %8s %8s %8s %8s %8s %8s\n", "driver", "vsync", "fps", "avg ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+	for (int driver = 0; (times != NULL) && (driver < SDL_GetNumRenderDrivers()); ++driver)
+	{
+		SDL_RendererInfo info;
+		if (SDL_GetRenderDriverInfo(driver, &info) != 0) continue;
+
+		for (int vsync = 0; vsync < 2; ++vsync)
 		{
-			if (state.shots[i].alive)
+			SDL_SetHint(SDL_HINT_RENDER_DRIVER, info.name);
+
+			resources.window = SDL_CreateWindow("2021: Space Odyssey", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+			resources.renderer = (resources.window != NULL)? SDL_CreateRenderer(resources.window, -1, vsync? SDL_RENDERER_PRESENTVSYNC : 0) : NULL;
+
+			SDL_RendererInfo created;
+			if ((resources.renderer == NULL) || (SDL_GetRendererInfo(resources.renderer, &created) != 0) || (SDL_strcmp(created.name, info.name) != 0))
+			{
+				printf("  %-12s %-6s unavailable: %s\n", info.name, vsync? "on" : "off", (resources.renderer == NULL)? SDL_GetError() : "another driver was created");
+			}
+			else
 			{
-				//DrawRectangle(state.shots[i].x, state.shots[i].y, 50, 20, { 0, 250, 0, 255 });
-				rec.x = state.shots[i].x; rec.y = state.shots[i].y;
-				SDL_RenderCopy(state.renderer, state.shot, NULL, &rec);
+				DrawReplayFrames(times);
+
+				float total = 0.0f;
+				for (int i = 0; i < BENCH_RENDER_FRAMES; ++i) total += times[i];
+				SDL_qsort(times, BENCH_RENDER_FRAMES, sizeof(float), CompareFrameTimes);
+
+				printf("  %-12s %-6s %8.1f %8.2f %8.2f %8.2f %8.2f %8.2f\n", info.name, vsync? "on" : "off", BENCH_RENDER_FRAMES*1000.0f/total,
+					total/BENCH_RENDER_FRAMES, times[BENCH_RENDER_FRAMES/2], times[BENCH_RENDER_FRAMES*9/10], times[BENCH_RENDER_FRAMES*99/100], times[BENCH_RENDER_FRAMES - 1]);
 			}
+
+			if (resources.renderer != NULL) SDL_DestroyRenderer(resources.renderer);
+			if (resources.window != NULL) SDL_DestroyWindow(resources.window);
+			resources.renderer = NULL;
+			resources.window = NULL;
 		}
+	}
 
-	} break;
-	case ENDING:
+	SDL_free(times);
+	CloseReplay(&replay);
+	IMG_Quit();
+	SDL_Quit();
+}
+
+// ----------------------------------------------------------------
+// Batch games with the --bot skill, every skill without it
+// In versus the second ship plays the --bot2 skill, the first ship one without it
+void RunBatches()
+{
+	if (options.seed == 0) options.seed = (Uint32)time(NULL);
+
+	BatchConfig config;
+	config.games = options.batch;
+	config.ticks = options.batch_ticks;
+	config.players = options.players;
+	config.seed = options.seed;
+	config.lanes = !options.batch_scalar;
+	config.check = options.batch_check && config.lanes;
+
+	BotSkill first = (options.bots[0] != BOT_OFF)? options.bots[0] : BOT_NOVICE;
+	BotSkill last = (options.bots[0] != BOT_OFF)? options.bots[0] : BOT_EXPERT;
+
+	for (int skill = first; skill <= last; ++skill)
 	{
-		SDL_Rect rec = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
-		SDL_RenderCopy(state.renderer, state.gameover, NULL, &rec);
-	} break;
-	default: break;
+		config.skills[0] = (BotSkill)skill;
+		config.skills[1] = (options.bots[1] != BOT_OFF)? options.bots[1] : (BotSkill)skill;
+
+		BatchStats stats = RunBatch(&config);
+		PrintBatchStats(GetBotSkillName(config.skills[0]), &stats);
 	}
 
-	// Finally present framebuffer
-	SDL_RenderPresent(state.renderer);
+	printf("Batch seed %u, %i ticks per game\n", options.seed, options.batch_ticks);
 }
 
+// ----------------------------------------------------------------
+void ParseOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (SDL_strcmp(argv[i], "--custom-mixer") == 0) options.custom_mixer = true;
+		else if (SDL_strcmp(argv[i], "--bench-mixer") == 0) options.bench_mixer = true;
+		else if (SDL_strcmp(argv[i], "--bench-env") == 0) options.bench_env = true;
+		else if ((SDL_strcmp(argv[i], "--bench-renderers") == 0) && (i + 1 < argc)) options.bench_renderers = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--golden") == 0) && (i + 1 < argc)) options.golden = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--golden-dir") == 0) && (i + 1 < argc)) options.golden_dir = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--golden-every") == 0) && (i + 1 < argc)) options.golden_every = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--golden-tolerance") == 0) && (i + 1 < argc)) options.golden_tolerance = SDL_atoi(argv[++i]);
+		else if (SDL_strcmp(argv[i], "--golden-update") == 0) options.golden_update = true;
+		else if (SDL_strcmp(argv[i], "--golden-target") == 0) options.golden_target = true;
+		else if (SDL_strcmp(argv[i], "--latency") == 0) options.latency = true;
+		else if ((SDL_strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc)) options.jobs = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) options.seed = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+		else if ((SDL_strcmp(argv[i], "--frame-trace") == 0) && (i + 1 < argc)) options.frame_trace = argv[++i];
+		else if (SDL_strcmp(argv[i], "--governor") == 0) options.governor = true;
+		else if ((SDL_strcmp(argv[i], "--fps") == 0) && (i + 1 < argc))
+		{
+			const char* fps = argv[++i];
+
+			if (SDL_strcmp(fps, "display") == 0) options.fps = PACING_DISPLAY;
+			else if (SDL_strcmp(fps, "unlimited") == 0) options.fps = PACING_UNLIMITED;
+			else options.fps = SDL_max(SDL_atoi(fps), PACING_UNLIMITED);
+		}
+		else if ((SDL_strcmp(argv[i], "--snapshot") == 0) && (i + 1 < argc)) options.snapshot = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--record") == 0) && (i + 1 < argc)) options.record = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--capture") == 0) && (i + 1 < argc)) options.capture = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--replay") == 0) && (i + 1 < argc)) options.replay = argv[++i];
+		else if ((SDL_strcmp(argv[i], "--check") == 0) && (i + 1 < argc)) options.check = argv[++i];
+		else if (SDL_strcmp(argv[i], "--versus") == 0) options.players = 2;
+		else if (SDL_strcmp(argv[i], "--netplay-loopback") == 0) options.netplay = NETPLAY_LOOPBACK;
+		else if ((SDL_strcmp(argv[i], "--host") == 0) && (i + 1 < argc))
+		{
+			options.netplay = NETPLAY_HOST;
+			options.net_port = SDL_atoi(argv[++i]);
+		}
+		else if ((SDL_strcmp(argv[i], "--join") == 0) && (i + 1 < argc))
+		{
+			if (ParseHostPort(argv[++i], &options.net_host, &options.net_port)) options.netplay = NETPLAY_JOIN;
+		}
+		else if ((SDL_strcmp(argv[i], "--bot") == 0) && (i + 1 < argc)) options.bots[0] = GetBotSkill(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--bot2") == 0) && (i + 1 < argc)) options.bots[1] = GetBotSkill(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--batch") == 0) && (i + 1 < argc)) options.batch = SDL_atoi(argv[++i]);
+		else if (SDL_strcmp(argv[i], "--batch-scalar") == 0) options.batch_scalar = true;
+		else if (SDL_strcmp(argv[i], "--batch-check") == 0) options.batch_check = true;
+		else if ((SDL_strcmp(argv[i], "--batch-ticks") == 0) && (i + 1 < argc)) options.batch_ticks = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--broadcast") == 0) && (i + 1 < argc)) options.broadcast_port = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--spectate") == 0) && (i + 1 < argc)) ParseHostPort(argv[++i], &options.spectate_host, &options.spectate_port);
+		else if ((SDL_strcmp(argv[i], "--spectate-check") == 0) && (i + 1 < argc)) options.spectate_check = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--net-latency") == 0) && (i + 1 < argc)) options.net_latency = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--net-loss") == 0) && (i + 1 < argc)) options.net_loss = SDL_atoi(argv[++i]);
+		else if ((SDL_strcmp(argv[i], "--replay-from") == 0) && (i + 1 < argc)) options.replay_start = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+		else if ((SDL_strcmp(argv[i], "--audio-buffer") == 0) && (i + 1 < argc))
+		{
+			options.audio_buffer = SDL_atoi(argv[++i]);
+			options.adaptive_audio = false;
+		}
+		else printf("WARNING: Unknown option %s\n", argv[i]);
+	}
+
+	if (options.audio_buffer < 64) options.audio_buffer = 64;
+}
 
 // Main Entry point
 // -------------------------------------------------------------------------
 int main(int argc, char* argv[])
 {
-	Start();
+	ParseOptions(argc, argv);
+
+	if (options.bench_mixer)
+	{
+		RunMixerBenchmark();
+		return(EXIT_SUCCESS);
+	}
+
+	// Headless, --jobs picks the thread count to validate
+	if (options.check != NULL)
+	{
+		InitJobs(options.jobs);
+		bool same = CheckReplay(options.check);
+		CloseJobs();
+		return(same? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// Headless, spectators are on the loopback interface
+	if (options.spectate_check != 0)
+	{
+		if (options.seed == 0) options.seed = (Uint32)time(NULL);
+
+		InitJobs(options.jobs);
+		bool same = CheckBroadcast(options.spectate_check, options.seed, options.players);
+		CloseJobs();
+		return(same? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// Headless, the replay simulation also runs the asteroids jobs
+	if (options.golden != NULL)
+	{
+		InitJobs(options.jobs);
+		bool same = RunGoldenCheck();
+		CloseJobs();
+		return(same? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (options.bench_renderers != NULL)
+	{
+		InitJobs(options.jobs);
+		RunRendererBenchmark();
+		CloseJobs();
+		return(EXIT_SUCCESS);
+	}
+
+	if (options.bench_env)
+	{
+		InitJobs(options.jobs);
+		RunEnvBenchmark();
+		CloseJobs();
+		return(EXIT_SUCCESS);
+	}
 
-	while (CheckInput())
+	if (options.batch > 0)
 	{
-		MoveStuff();
+		InitJobs(options.jobs);
+		RunBatches();
+		CloseJobs();
+		return(EXIT_SUCCESS);
+	}
 
-		Draw();
+	Start();
+	InitFrame();
+
+	while (state.running)
+	{
+		RunFrameGraph();
+		PaceFrame();
 	}
 
 	Finish();
@@ -727,33 +1505,33 @@ int main(int argc, char* argv[])
 // -------------------------------------------------------------------------
 void DrawRectangle(int x, int y, int width, int height, SDL_Color color)
 {
-	SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(state.renderer, color.r, color.g, color.b, color.a);
+	SDL_SetRenderDrawBlendMode(resources.renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(resources.renderer, color.r, color.g, color.b, color.a);
 
 	SDL_Rect rec = { x, y, width, height };
 
-	int result = SDL_RenderFillRect(state.renderer, &rec);
+	int result = SDL_RenderFillRect(resources.renderer, &rec);
 
 	if (result != 0) printf("Cannot draw quad to screen. SDL_RenderFillRect error: %s", SDL_GetError());
 }
 // -------------------------------------------------------------------------
 void Spawn(int x, int y, int width, int height, SDL_Color color) {
-	SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(state.renderer, color.r, color.g, color.b, color.a);
+	SDL_SetRenderDrawBlendMode(resources.renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(resources.renderer, color.r, color.g, color.b, color.a);
 
 	SDL_Rect rec = { x, y, width, height };
 
-	int result = SDL_RenderFillRect(state.renderer, &rec);
+	int result = SDL_RenderFillRect(resources.renderer, &rec);
 
 	if (result != 0) printf("Cannot draw quad to screen. SDL_RenderFillRect error: %s", SDL_GetError());
 }
 // ----------------------------------------------------------------
 void DrawLine(int x1, int y1, int x2, int y2, SDL_Color color)
 {
-	SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(state.renderer, color.r, color.g, color.b, color.a);
+	SDL_SetRenderDrawBlendMode(resources.renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(resources.renderer, color.r, color.g, color.b, color.a);
 
-	int result = SDL_RenderDrawLine(state.renderer, x1, y1, x2, y2);
+	int result = SDL_RenderDrawLine(resources.renderer, x1, y1, x2, y2);
 
 	if (result != 0) printf("Cannot draw quad to screen. SDL_RenderFillRect error: %s", SDL_GetError());
 }
@@ -761,8 +1539,8 @@ void DrawLine(int x1, int y1, int x2, int y2, SDL_Color color)
 // ----------------------------------------------------------------
 void DrawCircle(int x, int y, int radius, SDL_Color color)
 {
-	SDL_SetRenderDrawBlendMode(state.renderer, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(state.renderer, color.r, color.g, color.b, color.a);
+	SDL_SetRenderDrawBlendMode(resources.renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(resources.renderer, color.r, color.g, color.b, color.a);
 
 	SDL_Point points[360];
 	float factor = (float)M_PI / 180.0f;
@@ -773,7 +1551,7 @@ void DrawCircle(int x, int y, int radius, SDL_Color color)
 		points[i].y = (int)(y + radius * sinf(factor * i));
 	}
 
-	int result = SDL_RenderDrawPoints(state.renderer, points, 360);
+	int result = SDL_RenderDrawPoints(resources.renderer, points, 360);
 
 	if (result != 0) printf("Cannot draw quad to screen. SDL_RenderFillRect error: %s", SDL_GetError());
 }
\ No newline at end of file
@@ -0,0 +1,513 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Mixer - In-house sound effects mixer running as SDL_mixer post-mix
+//
+// The stream handed by SDL_mixer (already containing the music) is
+// converted once to float, every voice is accumulated on top with its
+// gain ramp, and the result is soft clipped back to 16 bit. SDL_mixer
+// instead walks the whole buffer once per channel with integer clamping.
+// -------------------------------------------------------------------------
+
+#include "Mixer.h"
+#include "Queue.h"
+
+#include <stdio.h>			// Required for: printf()
+#include <math.h>			// Required for: fabsf()
+
+#if defined(__AVX2__)
+#include <immintrin.h>		// Required for: AVX2 intrinsics (SSE2 ones come with SDL_cpuinfo.h)
+#endif
+
+#define MIXER_BLOCK_SAMPLES		(MIXER_BLOCK_FRAMES*2)
+#define MIXER_SOFT_KNEE			0.5f	// Output level where the soft clipper starts to bend
+
+enum MixerCommandType
+{
+	CMD_PLAY = 0,
+	CMD_STOP
+};
+
+struct MixerCommand
+{
+	int type;
+	int voice;
+	const Sint16* pcm;
+	int samples;
+	float gain;
+	int serial;
+};
+
+struct MixerVoice
+{
+	const Sint16* pcm;		// Interleaved stereo samples
+	int samples;
+	int pos;
+	float gain;				// Gain at the start of the next block
+	float target;			// Gain reached at the end of the next block
+	int serial;				// Play request that started the voice, -1 for fading tails
+	bool active;
+	bool ended;				// Finished during last callback, pending notification
+};
+
+typedef void (*LoadFunc)(float* acc, const Sint16* in, int n);
+typedef void (*AccumulateFunc)(float* acc, const Sint16* src, int n, float gain, float step);
+typedef void (*StoreFunc)(Sint16* out, const float* acc, int n);
+
+struct MixKernels
+{
+	const char* name;
+	LoadFunc load;
+	AccumulateFunc accumulate;
+	StoreFunc store;
+};
+
+static SpscQueue<MixerCommand, 256> commands;		// Game thread -> audio thread
+static MixerVoice voices[MIXER_MAX_VOICES];			// Owned by the audio thread
+static MixerVoice tails[MIXER_MAX_VOICES];			// Stopped or stolen sounds fading out
+static SDL_atomic_t voice_serial[MIXER_MAX_VOICES];
+static void* voice_finished = NULL;					// Finished callback, swapped atomically
+
+alignas(32) static float accum[MIXER_BLOCK_SAMPLES];
+
+// Scalar kernels
+// -------------------------------------------------------------------------
+static void LoadScalar(float* acc, const Sint16* in, int n)
+{
+	for (int i = 0; i < n; ++i) acc[i] = (float)in[i];
+}
+
+// NOTE: Gain changes once per frame, so both samples of a frame share it
+static void AccumulateScalar(float* acc, const Sint16* src, int n, float gain, float step)
+{
+	for (int i = 0; i < n; i += 2)
+	{
+		acc[i] += src[i]*gain;
+		acc[i + 1] += src[i + 1]*gain;
+		gain += step;
+	}
+}
+
+// Linear up to the knee, then a rational tanh approximation that reaches 1.0
+static float SoftClip(float x)
+{
+	float a = fabsf(x);
+	if (a <= MIXER_SOFT_KNEE) return x;
+
+	float c = (a - MIXER_SOFT_KNEE)/(1.0f - MIXER_SOFT_KNEE);
+	if (c > 3.0f) c = 3.0f;
+
+	float y = MIXER_SOFT_KNEE + (1.0f - MIXER_SOFT_KNEE)*c*(27.0f + c*c)/(27.0f + 9.0f*c*c);
+
+	return (x < 0.0f)? -y : y;
+}
+
+static void StoreScalar(Sint16* out, const float* acc, int n)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		float y = SoftClip(acc[i]/32768.0f)*32767.0f;
+		out[i] = (Sint16)((y >= 0.0f)? (y + 0.5f) : (y - 0.5f));
+	}
+}
+
+// SSE2 kernels
+// -------------------------------------------------------------------------
+#if defined(__SSE2__)
+static void LoadSSE2(float* acc, const Sint16* in, int n)
+{
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+		_mm_store_ps(acc + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+		_mm_store_ps(acc + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+	}
+
+	LoadScalar(acc + i, in + i, n - i);
+}
+
+static void AccumulateSSE2(float* acc, const Sint16* src, int n, float gain, float step)
+{
+	// Lanes hold L,R,L,R of two consecutive frames
+	__m128 g0 = _mm_set_ps(gain + step, gain + step, gain, gain);
+	__m128 g1 = _mm_add_ps(g0, _mm_set1_ps(2.0f*step));
+	__m128 gstep = _mm_set1_ps(4.0f*step);
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+
+		_mm_store_ps(acc + i, _mm_add_ps(_mm_load_ps(acc + i), _mm_mul_ps(lo, g0)));
+		_mm_store_ps(acc + i + 4, _mm_add_ps(_mm_load_ps(acc + i + 4), _mm_mul_ps(hi, g1)));
+
+		g0 = _mm_add_ps(g0, gstep);
+		g1 = _mm_add_ps(g1, gstep);
+	}
+
+	AccumulateScalar(acc + i, src + i, n - i, gain + step*(i/2), step);
+}
+
+static __m128 SoftClipSSE2(__m128 x)
+{
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 knee = _mm_set1_ps(MIXER_SOFT_KNEE);
+	const __m128 range = _mm_set1_ps(1.0f - MIXER_SOFT_KNEE);
+	const __m128 inv_range = _mm_set1_ps(1.0f/(1.0f - MIXER_SOFT_KNEE));
+	const __m128 c3 = _mm_set1_ps(3.0f);
+	const __m128 c9 = _mm_set1_ps(9.0f);
+	const __m128 c27 = _mm_set1_ps(27.0f);
+
+	// Branch-free version of SoftClip(): below the knee c is 0, so y = |x|
+	__m128 sign = _mm_and_ps(x, sign_mask);
+	__m128 a = _mm_andnot_ps(sign_mask, x);
+	__m128 c = _mm_min_ps(_mm_mul_ps(_mm_max_ps(_mm_sub_ps(a, knee), _mm_setzero_ps()), inv_range), c3);
+	__m128 c2 = _mm_mul_ps(c, c);
+	__m128 t = _mm_div_ps(_mm_mul_ps(c, _mm_add_ps(c27, c2)), _mm_add_ps(c27, _mm_mul_ps(c9, c2)));
+	__m128 y = _mm_add_ps(_mm_min_ps(a, knee), _mm_mul_ps(range, t));
+
+	return _mm_or_ps(y, sign);
+}
+
+static void StoreSSE2(Sint16* out, const float* acc, int n)
+{
+	const __m128 in_scale = _mm_set1_ps(1.0f/32768.0f);
+	const __m128 out_scale = _mm_set1_ps(32767.0f);
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128 lo = _mm_mul_ps(SoftClipSSE2(_mm_mul_ps(_mm_load_ps(acc + i), in_scale)), out_scale);
+		__m128 hi = _mm_mul_ps(SoftClipSSE2(_mm_mul_ps(_mm_load_ps(acc + i + 4), in_scale)), out_scale);
+
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+	}
+
+	StoreScalar(out + i, acc + i, n - i);
+}
+#endif
+
+// AVX2 kernels (only compiled when the build targets AVX2)
+// -------------------------------------------------------------------------
+#if defined(__AVX2__)
+static void AccumulateAVX2(float* acc, const Sint16* src, int n, float gain, float step)
+{
+	__m256 g = _mm256_set_ps(gain + 3*step, gain + 3*step, gain + 2*step, gain + 2*step, gain + step, gain + step, gain, gain);
+	__m256 gstep = _mm256_set1_ps(4.0f*step);
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i))));
+
+		_mm256_store_ps(acc + i, _mm256_add_ps(_mm256_load_ps(acc + i), _mm256_mul_ps(v, g)));
+		g = _mm256_add_ps(g, gstep);
+	}
+
+	AccumulateScalar(acc + i, src + i, n - i, gain + step*(i/2), step);
+}
+#endif
+
+static const MixKernels kernels_scalar = { "scalar", LoadScalar, AccumulateScalar, StoreScalar };
+#if defined(__SSE2__)
+static const MixKernels kernels_sse2 = { "sse2", LoadSSE2, AccumulateSSE2, StoreSSE2 };
+#endif
+#if defined(__AVX2__)
+static const MixKernels kernels_avx2 = { "avx2", LoadSSE2, AccumulateAVX2, StoreSSE2 };
+#endif
+
+static const MixKernels* BestKernels()
+{
+#if defined(__AVX2__)
+	return &kernels_avx2;
+#elif defined(__SSE2__)
+	return &kernels_sse2;
+#else
+	return &kernels_scalar;
+#endif
+}
+
+// Mixing
+// -------------------------------------------------------------------------
+static void MixVoice(const MixKernels* k, MixerVoice* v, int samples)
+{
+	int n = v->samples - v->pos;
+	if (n > samples) n = samples;
+
+	k->accumulate(accum, v->pcm + v->pos, n, v->gain, (v->target - v->gain)/(samples/2));
+
+	v->pos += n;
+	v->gain = v->target;
+
+	// Tails are done once their ramp reached silence
+	if ((v->pos >= v->samples) || ((v->serial < 0) && (v->target == 0.0f)))
+	{
+		v->active = false;
+		v->ended = true;
+	}
+}
+
+// Load the block once, add the fading tails (may be NULL) and the voices, store it once
+// NOTE: samples must not exceed MIXER_BLOCK_SAMPLES
+static void MixBlock(const MixKernels* k, Sint16* out, int samples, MixerVoice* fading, MixerVoice* list, int count)
+{
+	k->load(accum, out, samples);
+
+	for (int i = 0; i < count; ++i)
+	{
+		if ((fading != NULL) && fading[i].active) MixVoice(k, &fading[i], samples);
+		if (list[i].active) MixVoice(k, &list[i], samples);
+	}
+
+	k->store(out, accum, samples);
+}
+
+static void ProcessCommands()
+{
+	MixerCommand cmd;
+
+	while (commands.Pop(&cmd))
+	{
+		MixerVoice* v = &voices[cmd.voice];
+
+		// Keep the previous sound alive as a tail so it fades out instead of clicking
+		if (v->active)
+		{
+			tails[cmd.voice] = *v;
+			tails[cmd.voice].target = 0.0f;
+			tails[cmd.voice].serial = -1;
+			v->active = false;
+			v->ended = (cmd.type == CMD_STOP);
+		}
+
+		if (cmd.type == CMD_PLAY)
+		{
+			v->pcm = cmd.pcm;
+			v->samples = cmd.samples;
+			v->pos = 0;
+			v->gain = cmd.gain;
+			v->target = cmd.gain;
+			v->serial = cmd.serial;
+			v->active = true;
+			v->ended = false;
+		}
+	}
+}
+
+// ----------------------------------------------------------------
+void MixerPostMix(Uint8* stream, int len)
+{
+	const MixKernels* k = BestKernels();
+	Sint16* out = (Sint16*)stream;
+	int samples = len/2;
+
+	ProcessCommands();
+
+	// Nothing to add: leave the music as SDL_mixer wrote it, the soft clipper included
+	bool playing = false;
+	for (int i = 0; (i < MIXER_MAX_VOICES) && !playing; ++i) playing = voices[i].active || tails[i].active;
+	if (!playing) samples = 0;
+
+	while (samples > 0)
+	{
+		int n = (samples < MIXER_BLOCK_SAMPLES)? samples : MIXER_BLOCK_SAMPLES;
+
+		MixBlock(k, out, n, tails, voices, MIXER_MAX_VOICES);
+
+		out += n;
+		samples -= n;
+	}
+
+	// Notify finished voices, unless a newer play request already reused them
+	void (SDLCALL *finished)(int) = (void (SDLCALL *)(int))SDL_AtomicGetPtr(&voice_finished);
+
+	for (int i = 0; i < MIXER_MAX_VOICES; ++i)
+	{
+		if (voices[i].ended)
+		{
+			voices[i].ended = false;
+			if ((finished != NULL) && (SDL_AtomicGet(&voice_serial[i]) == voices[i].serial)) finished(i);
+		}
+
+		tails[i].ended = false;
+	}
+}
+
+// ----------------------------------------------------------------
+bool InitMixer()
+{
+	int frequency = 0;
+	Uint16 format = 0;
+	int channels = 0;
+
+	if ((Mix_QuerySpec(&frequency, &format, &channels) == 0) || (format != AUDIO_S16SYS) || (channels != 2))
+	{
+		printf("WARNING: In-house mixer requires an opened 16 bit stereo device, using SDL_mixer channels\n");
+		return false;
+	}
+
+	commands.Clear();
+	SDL_zeroa(voices);
+	SDL_zeroa(tails);
+	for (int i = 0; i < MIXER_MAX_VOICES; ++i) SDL_AtomicSet(&voice_serial[i], 0);
+
+	printf("In-house mixer enabled (%s)\n", BestKernels()->name);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void CloseMixer()
+{
+	SDL_zeroa(voices);
+	SDL_zeroa(tails);
+	SDL_AtomicSetPtr(&voice_finished, NULL);
+}
+
+// ----------------------------------------------------------------
+bool MixerPlay(int voice, const Mix_Chunk* chunk, float gain)
+{
+	if ((voice < 0) || (voice >= MIXER_MAX_VOICES) || (chunk == NULL)) return false;
+
+	MixerCommand cmd = { CMD_PLAY, voice, (const Sint16*)chunk->abuf, (int)(chunk->alen/4)*2, gain, 0 };
+	cmd.serial = SDL_AtomicAdd(&voice_serial[voice], 1) + 1;
+
+	return commands.Push(cmd);
+}
+
+// ----------------------------------------------------------------
+void MixerStop(int voice)
+{
+	if ((voice < 0) || (voice >= MIXER_MAX_VOICES)) return;
+
+	MixerCommand cmd = { CMD_STOP, voice, NULL, 0, 0.0f, 0 };
+	commands.Push(cmd);
+}
+
+// ----------------------------------------------------------------
+void MixerVoiceFinished(void (SDLCALL *finished)(int voice))
+{
+	SDL_AtomicSetPtr(&voice_finished, (void*)finished);
+}
+
+// Benchmark
+// -------------------------------------------------------------------------
+#define BENCH_FREQUENCY		44100
+#define BENCH_VOICE_SAMPLES	(BENCH_FREQUENCY*2)		// One second of stereo audio per voice
+#define BENCH_ITERATIONS	2000
+
+static void FillNoise(Sint16* buffer, int samples, Uint32* seed)
+{
+	for (int i = 0; i < samples; ++i)
+	{
+		*seed = *seed*1664525 + 1013904223;
+		buffer[i] = (Sint16)((*seed >> 16)/4 - 8192);
+	}
+}
+
+// Same work SDL_mixer does per callback: one SDL_MixAudioFormat() per playing channel
+static double BenchSDLMixer(Sint16* out, const Sint16* music, const Sint16* pcm, int voice_count, int frames)
+{
+	int samples = frames*2;
+	int pos = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (int it = 0; it < BENCH_ITERATIONS; ++it)
+	{
+		if (pos + samples > BENCH_VOICE_SAMPLES) pos = 0;
+
+		SDL_memcpy(out, music, samples*sizeof(Sint16));
+		for (int v = 0; v < voice_count; ++v) SDL_MixAudioFormat((Uint8*)out, (const Uint8*)(pcm + v*BENCH_VOICE_SAMPLES + pos), AUDIO_S16SYS, samples*sizeof(Sint16), MIX_MAX_VOLUME/2);
+
+		pos += samples;
+	}
+
+	return (double)(SDL_GetPerformanceCounter() - start)*1000000.0/SDL_GetPerformanceFrequency()/BENCH_ITERATIONS;
+}
+
+static double BenchKernels(const MixKernels* k, Sint16* out, const Sint16* music, const Sint16* pcm, int voice_count, int frames)
+{
+	MixerVoice list[MIXER_MAX_VOICES];
+	int samples = frames*2;
+	int pos = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (int it = 0; it < BENCH_ITERATIONS; ++it)
+	{
+		if (pos + samples > BENCH_VOICE_SAMPLES) pos = 0;
+
+		for (int v = 0; v < voice_count; ++v)
+		{
+			list[v].pcm = pcm + v*BENCH_VOICE_SAMPLES;
+			list[v].samples = BENCH_VOICE_SAMPLES;
+			list[v].pos = pos;
+			list[v].gain = 0.5f;
+			list[v].target = (it & 1)? 0.5f : 0.45f;		// Keep gain ramps in the measure
+			list[v].serial = 0;
+			list[v].active = true;
+		}
+
+		SDL_memcpy(out, music, samples*sizeof(Sint16));
+		for (int offset = 0; offset < samples; offset += MIXER_BLOCK_SAMPLES)
+		{
+			int n = samples - offset;
+			if (n > MIXER_BLOCK_SAMPLES) n = MIXER_BLOCK_SAMPLES;
+			MixBlock(k, out + offset, n, NULL, list, voice_count);
+		}
+
+		pos += samples;
+	}
+
+	return (double)(SDL_GetPerformanceCounter() - start)*1000000.0/SDL_GetPerformanceFrequency()/BENCH_ITERATIONS;
+}
+
+// ----------------------------------------------------------------
+void RunMixerBenchmark()
+{
+	const MixKernels* paths[] =
+	{
+		&kernels_scalar,
+#if defined(__SSE2__)
+		&kernels_sse2,
+#endif
+#if defined(__AVX2__)
+		&kernels_avx2,
+#endif
+	};
+	const int path_count = sizeof(paths)/sizeof(paths[0]);
+	const int buffer_frames[] = { 128, 256, 512, 1024, 2048 };
+	const int voice_counts[] = { 8, MIXER_MAX_VOICES };
+
+	Sint16* pcm = (Sint16*)SDL_malloc(MIXER_MAX_VOICES*BENCH_VOICE_SAMPLES*sizeof(Sint16));
+	Sint16* music = (Sint16*)SDL_malloc(2048*2*sizeof(Sint16));
+	Sint16* out = (Sint16*)SDL_malloc(2048*2*sizeof(Sint16));
+	Uint32 seed = 1234;
+
+	FillNoise(pcm, MIXER_MAX_VOICES*BENCH_VOICE_SAMPLES, &seed);
+	FillNoise(music, 2048*2, &seed);
+
+	printf("Mixer benchmark: %i Hz stereo, time per callback in microseconds\n", BENCH_FREQUENCY);
+
+	for (int vc = 0; vc < (int)(sizeof(voice_counts)/sizeof(voice_counts[0])); ++vc)
+	{
+		printf("\n%i voices\n%8s %10s %10s", voice_counts[vc], "frames", "budget", "sdl_mixer");
+		for (int p = 0; p < path_count; ++p) printf(" %10s", paths[p]->name);
+		printf("\n");
+
+		for (int b = 0; b < (int)(sizeof(buffer_frames)/sizeof(buffer_frames[0])); ++b)
+		{
+			int frames = buffer_frames[b];
+
+			printf("%8i %10.1f %10.2f", frames, frames*1000000.0/BENCH_FREQUENCY, BenchSDLMixer(out, music, pcm, voice_counts[vc], frames));
+			for (int p = 0; p < path_count; ++p) printf(" %10.2f", BenchKernels(paths[p], out, music, pcm, voice_counts[vc], frames));
+			printf("\n");
+		}
+	}
+
+	SDL_free(out);
+	SDL_free(music);
+	SDL_free(pcm);
+}
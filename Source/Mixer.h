@@ -0,0 +1,43 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Mixer - In-house sound effects mixer running as SDL_mixer post-mix
+//
+// SDL_mixer keeps mixing the music, then the audio post-mix callback
+// (see Audio.cpp) lets this mixer add the sound effect voices on top
+// using float accumulation (SSE2/AVX2 when available), per-voice gain
+// ramps and a soft clipper, all inside one pass over each block. While no
+// voice plays the stream is left untouched.
+// -------------------------------------------------------------------------
+
+#ifndef __MIXER_H__
+#define __MIXER_H__
+
+#include "SDL/include/SDL.h"				// Required for SDL base systems functionality
+#include "SDL_mixer/include/SDL_mixer.h"	// Required for: Mix_Chunk
+
+#define MIXER_MAX_VOICES		32
+#define MIXER_BLOCK_FRAMES	   256		// Frames mixed per inner block, also the gain ramp length
+
+// Check the opened audio device and reset all voices
+// NOTE: Only signed 16 bit stereo output is supported, returns false otherwise
+bool InitMixer();
+// WARNING: Make sure MixerPostMix() is no longer called before closing
+void CloseMixer();
+
+// Mix all voices on top of the stream, called from the audio thread
+void MixerPostMix(Uint8* stream, int len);
+
+// Start a chunk on a voice; if the voice is already playing, the previous
+// sound is faded out during the next block instead of being cut
+// NOTE: Chunk must stay loaded until the voice finishes or CloseMixer()
+bool MixerPlay(int voice, const Mix_Chunk* chunk, float gain);
+void MixerStop(int voice);
+
+// Same contract as Mix_ChannelFinished(): called from the audio thread
+void MixerVoiceFinished(void (SDLCALL *finished)(int voice));
+
+// Compare SDL_mixer per-channel mixing against the in-house mixer paths,
+// it does not require an audio device
+void RunMixerBenchmark();
+
+#endif // __MIXER_H__
@@ -0,0 +1,501 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Net - Unreliable datagram transports: UDP and in-process loopback,
+// and reliable TCP streams
+// -------------------------------------------------------------------------
+
+#include "Net.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>		// Required for: socket(), sendto(), recvfrom()
+	#include <ws2tcpip.h>		// Required for: getaddrinfo()
+	typedef SOCKET NetSocket;
+	typedef int NetAddressSize;
+	#define NetCloseSocket closesocket
+	#define NET_SEND_FLAGS		0
+#else
+	#include <sys/socket.h>		// Required for: socket(), sendto(), recvfrom()
+	#include <netinet/in.h>		// Required for: sockaddr_in
+	#include <netinet/tcp.h>	// Required for: TCP_NODELAY
+	#include <netdb.h>			// Required for: getaddrinfo()
+	#include <fcntl.h>			// Required for: fcntl()
+	#include <unistd.h>			// Required for: close()
+	#include <errno.h>			// Required for: errno
+	typedef int NetSocket;
+	typedef socklen_t NetAddressSize;
+	#define INVALID_SOCKET		(-1)
+	#define NetCloseSocket close
+	#if defined(MSG_NOSIGNAL)
+		#define NET_SEND_FLAGS	MSG_NOSIGNAL	// A closed stream must not raise SIGPIPE
+	#else
+		#define NET_SEND_FLAGS	0
+	#endif
+#endif
+
+struct LoopbackQueue
+{
+	int first;
+	int count;
+	int sizes[NET_LOOPBACK_QUEUE];
+	Uint8 packets[NET_LOOPBACK_QUEUE][NET_MAX_PACKET];
+};
+
+struct LoopbackPair;
+
+struct LoopbackEnd
+{
+	LoopbackPair* pair;
+	int side;				// Receives from queues[side], sends to the other one
+};
+
+struct LoopbackPair
+{
+	LoopbackQueue queues[2];
+	LoopbackEnd ends[2];
+	int open;				// Ends not closed yet, freed with the last one
+};
+
+struct UdpLink
+{
+	NetSocket socket;
+	sockaddr_storage peer;
+	NetAddressSize peer_size;
+	bool has_peer;			// Hosts learn their peer from the first packet received
+};
+
+// Deterministic loss, the same conditions drop the same packets
+static Uint32 NextLossRandom(NetTransport* transport)
+{
+	Uint32 x = transport->rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return (transport->rng = x);
+}
+
+// Winsock counts its users, every socket opened starts it and every socket closed cleans it up
+static bool InitSockets()
+{
+#if defined(_WIN32)
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+	{
+		printf("WARNING: Unable to init Winsock\n");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static void CloseSockets()
+{
+#if defined(_WIN32)
+	WSACleanup();
+#endif
+}
+
+static bool SetNonBlocking(NetSocket socket)
+{
+#if defined(_WIN32)
+	u_long non_blocking = 1;
+	return (ioctlsocket(socket, FIONBIO, &non_blocking) == 0);
+#else
+	return (fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK) == 0);
+#endif
+}
+
+// Last socket call failed only because it would have waited
+static bool WouldBlock()
+{
+#if defined(_WIN32)
+	return (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+	return (errno == EWOULDBLOCK) || (errno == EAGAIN);
+#endif
+}
+
+static void InitTransport(NetTransport* transport)
+{
+	SDL_zerop(transport);
+	transport->rng = 0x2545F491;
+}
+
+static bool LoopbackSend(NetTransport* transport, const Uint8* data, int size)
+{
+	LoopbackEnd* end = (LoopbackEnd*)transport->data;
+	LoopbackQueue* queue = &end->pair->queues[1 - end->side];
+
+	if (queue->count == NET_LOOPBACK_QUEUE) return false;
+
+	int slot = (queue->first + queue->count)%NET_LOOPBACK_QUEUE;
+	SDL_memcpy(queue->packets[slot], data, size);
+	queue->sizes[slot] = size;
+	queue->count++;
+
+	return true;
+}
+
+static int LoopbackReceive(NetTransport* transport, Uint8* data, int capacity)
+{
+	LoopbackEnd* end = (LoopbackEnd*)transport->data;
+	LoopbackQueue* queue = &end->pair->queues[end->side];
+
+	if (queue->count == 0) return 0;
+
+	int size = SDL_min(queue->sizes[queue->first], capacity);
+	SDL_memcpy(data, queue->packets[queue->first], size);
+	queue->first = (queue->first + 1)%NET_LOOPBACK_QUEUE;
+	queue->count--;
+
+	return size;
+}
+
+static void LoopbackClose(NetTransport* transport)
+{
+	LoopbackEnd* end = (LoopbackEnd*)transport->data;
+
+	if (--end->pair->open == 0) SDL_free(end->pair);
+}
+
+static bool UdpSend(NetTransport* transport, const Uint8* data, int size)
+{
+	UdpLink* link = (UdpLink*)transport->data;
+
+	// Nobody to talk to yet, the host waits for the first packet
+	if (!link->has_peer) return false;
+
+	return sendto(link->socket, (const char*)data, size, 0, (const sockaddr*)&link->peer, link->peer_size) == size;
+}
+
+static int UdpReceive(NetTransport* transport, Uint8* data, int capacity)
+{
+	UdpLink* link = (UdpLink*)transport->data;
+	sockaddr_storage from;
+	NetAddressSize from_size = sizeof(from);
+
+	// NOTE: Non blocking socket, fails when there is nothing to read
+	int size = (int)recvfrom(link->socket, (char*)data, capacity, 0, (sockaddr*)&from, &from_size);
+	if (size <= 0) return 0;
+
+	if (!link->has_peer)
+	{
+		link->peer = from;
+		link->peer_size = from_size;
+		link->has_peer = true;
+	}
+
+	return size;
+}
+
+static void UdpClose(NetTransport* transport)
+{
+	UdpLink* link = (UdpLink*)transport->data;
+
+	NetCloseSocket(link->socket);
+	SDL_free(link);
+	CloseSockets();
+}
+
+// Send the delayed packets due by now, in the order they were sent
+static void FlushDelayed(NetTransport* transport)
+{
+	Uint32 now = SDL_GetTicks();
+
+	while (transport->delayed_count > 0)
+	{
+		NetDelayedPacket* packet = &transport->delayed[transport->delayed_first];
+		if (!SDL_TICKS_PASSED(now, packet->due)) break;
+
+		if (!transport->send(transport, packet->data, packet->size)) transport->stats.overflows++;
+
+		transport->delayed_first = (transport->delayed_first + 1)%NET_MAX_DELAYED;
+		transport->delayed_count--;
+	}
+}
+
+// ----------------------------------------------------------------
+bool OpenLoopbackTransports(NetTransport* a, NetTransport* b)
+{
+	LoopbackPair* pair = (LoopbackPair*)SDL_calloc(1, sizeof(LoopbackPair));
+	if (pair == NULL) return false;
+
+	NetTransport* transports[2] = { a, b };
+
+	for (int side = 0; side < 2; ++side)
+	{
+		InitTransport(transports[side]);
+		pair->ends[side].pair = pair;
+		pair->ends[side].side = side;
+		transports[side]->send = LoopbackSend;
+		transports[side]->receive = LoopbackReceive;
+		transports[side]->close = LoopbackClose;
+		transports[side]->data = &pair->ends[side];
+	}
+
+	pair->open = 2;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+bool OpenUdpTransport(NetTransport* transport, const char* host, int port)
+{
+	InitTransport(transport);
+
+	if (!InitSockets()) return false;
+
+	UdpLink* link = (UdpLink*)SDL_calloc(1, sizeof(UdpLink));
+	char service[16];
+	SDL_snprintf(service, sizeof(service), "%i", port);
+
+	// Hosts listen on port, joiners send to host:port from any local port
+	addrinfo hints;
+	SDL_zero(hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = (host == NULL)? AI_PASSIVE : 0;
+
+	addrinfo* address = NULL;
+	if (getaddrinfo(host, service, &hints, &address) != 0)
+	{
+		printf("WARNING: Unable to resolve %s:%i\n", (host != NULL)? host : "*", port);
+		SDL_free(link);
+		CloseSockets();
+		return false;
+	}
+
+	link->socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+	bool opened = (link->socket != INVALID_SOCKET);
+
+	if (opened && (host == NULL)) opened = (bind(link->socket, address->ai_addr, (NetAddressSize)address->ai_addrlen) == 0);
+	else if (opened)
+	{
+		SDL_memcpy(&link->peer, address->ai_addr, address->ai_addrlen);
+		link->peer_size = (NetAddressSize)address->ai_addrlen;
+		link->has_peer = true;
+	}
+
+	freeaddrinfo(address);
+
+	if (opened) opened = SetNonBlocking(link->socket);
+
+	if (!opened)
+	{
+		printf("WARNING: Unable to open UDP socket on port %i\n", port);
+		if (link->socket != INVALID_SOCKET) NetCloseSocket(link->socket);
+		SDL_free(link);
+		CloseSockets();
+		return false;
+	}
+
+	transport->send = UdpSend;
+	transport->receive = UdpReceive;
+	transport->close = UdpClose;
+	transport->data = link;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void CloseTransport(NetTransport* transport)
+{
+	if (transport->close != NULL) transport->close(transport);
+
+	SDL_free(transport->delayed);
+	SDL_zerop(transport);
+}
+
+// ----------------------------------------------------------------
+void SetTransportConditions(NetTransport* transport, int latency_ms, int loss_percent)
+{
+	transport->latency_ms = SDL_max(latency_ms, 0);
+	transport->loss_percent = SDL_max(0, SDL_min(loss_percent, 100));
+
+	if ((transport->latency_ms > 0) && (transport->delayed == NULL))
+	{
+		transport->delayed = (NetDelayedPacket*)SDL_calloc(NET_MAX_DELAYED, sizeof(NetDelayedPacket));
+		if (transport->delayed == NULL) transport->latency_ms = 0;
+	}
+}
+
+// ----------------------------------------------------------------
+bool NetSend(NetTransport* transport, const Uint8* data, int size)
+{
+	if ((transport->send == NULL) || (size > NET_MAX_PACKET)) return false;
+
+	transport->stats.sent++;
+
+	// Lost on the way, as far as the sender knows it left
+	if ((transport->loss_percent > 0) && ((int)(NextLossRandom(transport)%100) < transport->loss_percent))
+	{
+		transport->stats.dropped++;
+		return true;
+	}
+
+	if (transport->latency_ms == 0)
+	{
+		bool sent = transport->send(transport, data, size);
+		if (!sent) transport->stats.overflows++;
+		return sent;
+	}
+
+	if (transport->delayed_count == NET_MAX_DELAYED)
+	{
+		transport->stats.overflows++;
+		return false;
+	}
+
+	NetDelayedPacket* packet = &transport->delayed[(transport->delayed_first + transport->delayed_count)%NET_MAX_DELAYED];
+	packet->due = SDL_GetTicks() + transport->latency_ms;
+	packet->size = size;
+	SDL_memcpy(packet->data, data, size);
+	transport->delayed_count++;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+int NetReceive(NetTransport* transport, Uint8* data, int capacity)
+{
+	if (transport->receive == NULL) return 0;
+
+	if (transport->delayed_count > 0) FlushDelayed(transport);
+
+	int size = transport->receive(transport, data, capacity);
+	if (size > 0) transport->stats.received++;
+
+	return size;
+}
+
+// ----------------------------------------------------------------
+NetStream ListenStream(int port)
+{
+	if (!InitSockets()) return NET_NO_STREAM;
+
+	NetSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	bool opened = (listener != INVALID_SOCKET);
+
+	if (opened)
+	{
+		// Restarting the game must not wait for the old socket to time out
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+		sockaddr_in address;
+		SDL_zero(address);
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons((Uint16)port);
+
+		opened = (bind(listener, (const sockaddr*)&address, sizeof(address)) == 0) && (listen(listener, SOMAXCONN) == 0) && SetNonBlocking(listener);
+	}
+
+	if (!opened)
+	{
+		printf("WARNING: Unable to listen on TCP port %i\n", port);
+		if (listener != INVALID_SOCKET) NetCloseSocket(listener);
+		CloseSockets();
+		return NET_NO_STREAM;
+	}
+
+	return (NetStream)listener;
+}
+
+// ----------------------------------------------------------------
+NetStream AcceptStream(NetStream listener)
+{
+	NetSocket stream = accept((NetSocket)listener, NULL, NULL);
+	if (stream == INVALID_SOCKET) return NET_NO_STREAM;
+
+	// Small writes every tick, don't let them wait for more
+	int no_delay = 1;
+	setsockopt(stream, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+	if (!InitSockets())
+	{
+		NetCloseSocket(stream);
+		return NET_NO_STREAM;
+	}
+
+	if (!SetNonBlocking(stream))
+	{
+		NetCloseSocket(stream);
+		CloseSockets();
+		return NET_NO_STREAM;
+	}
+
+	return (NetStream)stream;
+}
+
+// ----------------------------------------------------------------
+NetStream ConnectStream(const char* host, int port)
+{
+	if (!InitSockets()) return NET_NO_STREAM;
+
+	char service[16];
+	SDL_snprintf(service, sizeof(service), "%i", port);
+
+	addrinfo hints;
+	SDL_zero(hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* address = NULL;
+	if (getaddrinfo(host, service, &hints, &address) != 0)
+	{
+		printf("WARNING: Unable to resolve %s:%i\n", host, port);
+		CloseSockets();
+		return NET_NO_STREAM;
+	}
+
+	NetSocket stream = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+	bool connected = (stream != INVALID_SOCKET) && (connect(stream, address->ai_addr, (NetAddressSize)address->ai_addrlen) == 0) && SetNonBlocking(stream);
+
+	freeaddrinfo(address);
+
+	if (!connected)
+	{
+		printf("WARNING: Unable to connect to %s:%i\n", host, port);
+		if (stream != INVALID_SOCKET) NetCloseSocket(stream);
+		CloseSockets();
+		return NET_NO_STREAM;
+	}
+
+	return (NetStream)stream;
+}
+
+// ----------------------------------------------------------------
+int SendStream(NetStream stream, const Uint8* data, int size)
+{
+	int sent = (int)send((NetSocket)stream, (const char*)data, size, NET_SEND_FLAGS);
+
+	if (sent < 0) return WouldBlock()? 0 : -1;
+
+	return sent;
+}
+
+// ----------------------------------------------------------------
+int ReceiveStream(NetStream stream, Uint8* data, int capacity)
+{
+	int received = (int)recv((NetSocket)stream, (char*)data, capacity, 0);
+
+	// NOTE: Zero bytes means the peer closed the stream, nothing pending is a would block error
+	if (received == 0) return -1;
+	if (received < 0) return WouldBlock()? 0 : -1;
+
+	return received;
+}
+
+// ----------------------------------------------------------------
+void CloseStream(NetStream stream)
+{
+	if (stream == NET_NO_STREAM) return;
+
+	NetCloseSocket((NetSocket)stream);
+	CloseSockets();
+}
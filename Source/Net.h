@@ -0,0 +1,100 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Net - Unreliable datagram transports: UDP and in-process loopback,
+// and reliable TCP streams
+//
+// Packets may be lost, duplicated or arrive out of order, like UDP ones.
+// Every transport can delay and drop the packets it sends on purpose, so
+// netplay is tested against bad connections without leaving the machine.
+// Streams are plain non blocking TCP sockets, for one to many broadcasts.
+// -------------------------------------------------------------------------
+
+#ifndef __NET_H__
+#define __NET_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define NET_MAX_PACKET		 512
+#define NET_MAX_DELAYED		 256		// Packets held back by the injected latency
+#define NET_LOOPBACK_QUEUE	 256		// Packets in flight per loopback direction
+
+#define NET_NO_STREAM		(-1)
+
+// Stream socket handle, NET_NO_STREAM if none
+typedef Sint64 NetStream;
+
+struct NetTransport;
+
+// Send returns false if the packet could not leave, receive returns the size of the next packet or 0 when none
+typedef bool (*NetSendFunction)(NetTransport* transport, const Uint8* data, int size);
+typedef int (*NetReceiveFunction)(NetTransport* transport, Uint8* data, int capacity);
+typedef void (*NetCloseFunction)(NetTransport* transport);
+
+struct NetDelayedPacket
+{
+	Uint32 due;					// SDL_GetTicks() time it really leaves
+	int size;
+	Uint8 data[NET_MAX_PACKET];
+};
+
+struct NetStats
+{
+	int sent;
+	int received;
+	int dropped;				// By the injected loss
+	int overflows;				// Queues full, packets lost anyway
+};
+
+struct NetTransport
+{
+	NetSendFunction send;
+	NetReceiveFunction receive;
+	NetCloseFunction close;
+	void* data;					// Transport own state
+
+	// Injected conditions, applied when sending
+	int latency_ms;
+	int loss_percent;
+	Uint32 rng;
+
+	NetDelayedPacket* delayed;	// Ring, allocated when latency is used
+	int delayed_first;
+	int delayed_count;
+
+	NetStats stats;
+};
+
+// Two transports connected to each other, only for use from one thread
+bool OpenLoopbackTransports(NetTransport* a, NetTransport* b);
+
+// UDP socket, host == NULL waits on port for the first peer, otherwise sends to host:port
+bool OpenUdpTransport(NetTransport* transport, const char* host, int port);
+
+void CloseTransport(NetTransport* transport);
+
+// Delay every packet sent by latency_ms and drop loss_percent of them
+void SetTransportConditions(NetTransport* transport, int latency_ms, int loss_percent);
+
+bool NetSend(NetTransport* transport, const Uint8* data, int size);
+
+// Next packet received, 0 if none is pending, also sends delayed packets due by now
+int NetReceive(NetTransport* transport, Uint8* data, int capacity);
+
+// Listen for streams on port, any interface
+NetStream ListenStream(int port);
+
+// Next stream connected to listener, NET_NO_STREAM if nobody is waiting
+NetStream AcceptStream(NetStream listener);
+
+// Connect to host:port, waits for the connection
+NetStream ConnectStream(const char* host, int port);
+
+// Bytes sent, maybe less than size when the socket buffer is full, -1 once the stream is closed
+int SendStream(NetStream stream, const Uint8* data, int size);
+
+// Bytes received, 0 if none are pending, -1 once the stream is closed
+int ReceiveStream(NetStream stream, Uint8* data, int capacity);
+
+void CloseStream(NetStream stream);
+
+#endif // __NET_H__
@@ -0,0 +1,131 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Pacing - Frame rate limiter and frame pacing counters
+// -------------------------------------------------------------------------
+
+#include "Pacing.h"
+#include "Input.h"
+
+static int target = PACING_DISPLAY;
+static Uint64 period = 0;			// Expected frame interval, counter ticks, 0 if unknown
+static Uint64 deadline = 0;			// Next frame start, limited frame rates only
+static Uint64 last_frame = 0;
+static Uint64 spin_margin = 0;
+
+static int frames = 0;
+static int missed = 0;
+static int stutters = 0;
+static Uint64 total_time = 0;
+static Uint64 max_time = 0;
+static Uint64 wait_time = 0;
+static Uint64 spin_time = 0;
+
+static Uint64 MillisecondsToCounter(double ms)
+{
+	return (Uint64)(ms*SDL_GetPerformanceFrequency()/1000.0);
+}
+
+// Sleep, then spin, until the deadline, pumping input all along
+static void WaitDeadline()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	while (now + spin_margin < deadline)
+	{
+		PumpInput();
+		SDL_Delay(1);
+
+		Uint64 woken = SDL_GetPerformanceCounter();
+		Uint64 slept = woken - now;
+		wait_time += slept;
+
+		// Oversleeping once means it may happen again, spin that long from now on
+		if (slept > spin_margin) spin_margin = SDL_min(slept, MillisecondsToCounter(PACING_MAX_SPIN_MS));
+		now = woken;
+	}
+
+	Uint64 spin_start = now;
+
+	while (now < deadline)
+	{
+		PumpInput();
+#if defined(__SSE2__)
+		_mm_pause();
+#endif
+		now = SDL_GetPerformanceCounter();
+	}
+
+	spin_time += now - spin_start;
+	wait_time += now - spin_start;
+}
+
+// ----------------------------------------------------------------
+void InitPacing(int fps, int display_hz)
+{
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+
+	target = fps;
+	period = 0;
+	if (fps > 0) period = frequency/fps;
+	else if ((fps == PACING_DISPLAY) && (display_hz > 0)) period = frequency/display_hz;
+
+	spin_margin = MillisecondsToCounter(PACING_SPIN_MS);
+	last_frame = SDL_GetPerformanceCounter();
+	deadline = last_frame + period;
+
+	frames = 0;
+	missed = 0;
+	stutters = 0;
+	total_time = 0;
+	max_time = 0;
+	wait_time = 0;
+	spin_time = 0;
+}
+
+// ----------------------------------------------------------------
+void PaceFrame()
+{
+	if (target > 0)
+	{
+		Uint64 now = SDL_GetPerformanceCounter();
+
+		// Too late to keep the grid, start a new one instead of rushing the frames behind
+		if (now > deadline + (Uint64)(period*PACING_SLACK))
+		{
+			missed++;
+			deadline = now;
+		}
+		else WaitDeadline();
+
+		deadline += period;
+	}
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 interval = now - last_frame;
+	last_frame = now;
+
+	// Unlimited frames have no period to keep, compare against the average so far
+	Uint64 expected = (period > 0)? period : ((frames > 0)? total_time/frames : 0);
+	if ((expected > 0) && (interval > (Uint64)(expected*PACING_STUTTER))) stutters++;
+
+	frames++;
+	total_time += interval;
+	if (interval > max_time) max_time = interval;
+}
+
+// ----------------------------------------------------------------
+PacingStats GetPacingStats()
+{
+	double ms = 1000.0/SDL_GetPerformanceFrequency();
+	PacingStats stats;
+
+	stats.frames = frames;
+	stats.missed = missed;
+	stats.stutters = stutters;
+	stats.avg_frame_ms = (frames > 0)? (float)(total_time*ms/frames) : 0.0f;
+	stats.max_frame_ms = (float)(max_time*ms);
+	stats.wait_ms = (float)(wait_time*ms);
+	stats.spin_ms = (float)(spin_time*ms);
+
+	return stats;
+}
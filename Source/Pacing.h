@@ -0,0 +1,50 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Pacing - Frame rate limiter and frame pacing counters
+//
+// Frames start on a grid of deadlines one target period apart. Waiting for
+// the next one sleeps in 1 ms steps while it is far, then spins on
+// SDL_GetPerformanceCounter() for the last stretch, as sleeps overshoot by
+// up to a timer period. The spin margin grows with the worst sleep seen.
+// Input keeps being pumped while waiting, so key edges get their real
+// timestamps instead of the next frame start (see PumpInput()).
+//
+// A frame that starts past its deadline by more than PACING_SLACK of the
+// period misses it: the grid restarts from now instead of rushing frames to
+// catch up. A stutter is a frame interval over PACING_STUTTER times the
+// target period, or the average interval when frames are not limited.
+// -------------------------------------------------------------------------
+
+#ifndef __PACING_H__
+#define __PACING_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#define PACING_UNLIMITED		   0		// Frames as fast as they go, vsync off
+#define PACING_DISPLAY			  -1		// Vsync paces frames at the display refresh rate
+
+#define PACING_SPIN_MS			 1.0		// Least time spun before a deadline
+#define PACING_MAX_SPIN_MS		 4.0		// Spin margin limit, however bad sleeps are
+#define PACING_SLACK			0.25		// Fraction of the period late before missing a deadline
+#define PACING_STUTTER			 1.5		// Frame interval over expected one by this factor
+
+struct PacingStats
+{
+	int frames;
+	int missed;					// Deadlines missed, limited frame rates only
+	int stutters;
+	float avg_frame_ms;			// Frame start to frame start
+	float max_frame_ms;
+	float wait_ms;				// Total time sleeping and spinning, the headroom left
+	float spin_ms;
+};
+
+// fps: target frames per second, PACING_UNLIMITED or PACING_DISPLAY; display_hz sets the expected period of the latter
+void InitPacing(int fps, int display_hz);
+
+// Main thread, once per frame: wait for the next deadline, when limited, and count the frame
+void PaceFrame();
+
+PacingStats GetPacingStats();
+
+#endif // __PACING_H__
@@ -0,0 +1,69 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Queue - Lock-free single producer / single consumer ring buffer
+//
+// One thread may only Push() and one other thread may only Pop().
+// SIZE must be a power of two; one slot is always left empty.
+// -------------------------------------------------------------------------
+
+#ifndef __QUEUE_H__
+#define __QUEUE_H__
+
+#include "SDL/include/SDL.h"		// Required for: SDL_atomic_t, SDL_CACHELINE_SIZE
+
+template <typename T, int SIZE>
+struct SpscQueue
+{
+	// NOTE: head and tail live in different cache lines to avoid false sharing
+	// between producer and consumer threads
+	SDL_atomic_t head;				// Next item to read, written by consumer
+	char pad0[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+	SDL_atomic_t tail;				// Next slot to write, written by producer
+	char pad1[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+	T items[SIZE];
+
+	void Clear()
+	{
+		SDL_AtomicSet(&head, 0);
+		SDL_AtomicSet(&tail, 0);
+	}
+
+	bool Push(const T& item)
+	{
+		int t = SDL_AtomicGet(&tail);
+		int next = (t + 1) & (SIZE - 1);
+
+		if (next == SDL_AtomicGet(&head)) return false;		// Full
+
+		items[t] = item;
+		SDL_AtomicSet(&tail, next);							// Publish after the item is written
+
+		return true;
+	}
+
+	bool Pop(T* item)
+	{
+		int h = SDL_AtomicGet(&head);
+
+		if (h == SDL_AtomicGet(&tail)) return false;		// Empty
+
+		*item = items[h];
+		SDL_AtomicSet(&head, (h + 1) & (SIZE - 1));
+
+		return true;
+	}
+
+	// Consumer side only: look at the next item without removing it
+	bool Peek(T* item)
+	{
+		int h = SDL_AtomicGet(&head);
+
+		if (h == SDL_AtomicGet(&tail)) return false;
+
+		*item = items[h];
+
+		return true;
+	}
+};
+
+#endif // __QUEUE_H__
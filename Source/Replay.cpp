@@ -0,0 +1,561 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Replay - Recorded sessions with a keyframe index for fast seeking
+// -------------------------------------------------------------------------
+
+#include "Replay.h"
+#include "Rewind.h"
+#include "Hash.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>		// Required for: CreateFileMapping(), MapViewOfFile()
+#else
+	#include <sys/mman.h>		// Required for: mmap(), munmap()
+	#include <sys/stat.h>		// Required for: fstat()
+	#include <fcntl.h>			// Required for: open()
+	#include <unistd.h>			// Required for: close()
+#endif
+
+#define REPLAY_MAGIC		0x594C5052		// "RPLY"
+#define CHUNK_MAGIC			0x4B4E4843		// "CHNK"
+#define INDEX_MAGIC			0x58444952		// "RIDX"
+
+#define HEADER_SIZE			  16
+#define CHUNK_HEADER_SIZE	  16
+#define INDEX_ENTRY_SIZE	  12
+#define FOOTER_SIZE			  12
+
+struct ChunkData
+{
+	const Uint8* keyframe;
+	int keyframe_size;
+	const Uint8* actions;
+	int actions_size;
+	const Uint8* hashes;
+	int hash_count;
+};
+
+// Recording state
+static SDL_RWops* recording = NULL;
+static SimState chunk_keyframe;
+static Uint32 chunk_tick = 0;
+static int chunk_ticks = 0;
+static Uint8 chunk_actions[2*REPLAY_CHUNK_TICKS];	// [repeat count][actions] pairs
+static int chunk_actions_size = 0;
+static Uint32 chunk_hashes[REPLAY_CHUNK_TICKS];
+static Uint32 next_tick = 0;
+static ReplayChunk* chunk_index = NULL;
+static int chunk_index_count = 0;
+static int chunk_index_capacity = 0;
+static Uint32 ticks_recorded = 0;
+
+static Uint16 Read16(const Uint8* data)
+{
+	return (Uint16)(data[0] | (data[1] << 8));
+}
+
+static Uint32 Read32(const Uint8* data)
+{
+	return (Uint32)data[0] | ((Uint32)data[1] << 8) | ((Uint32)data[2] << 16) | ((Uint32)data[3] << 24);
+}
+
+// Append a chunk to a tick sorted index, a chunk starting earlier than
+// the last ones replaces them (the run went back in time)
+static void AddChunk(ReplayChunk** chunks, int* count, int* capacity, Uint32 tick, Uint32 ticks, Uint32 offset)
+{
+	while ((*count > 0) && ((*chunks)[*count - 1].tick >= tick)) (*count)--;
+	if ((*count > 0) && ((*chunks)[*count - 1].tick + (*chunks)[*count - 1].ticks > tick)) (*chunks)[*count - 1].ticks = tick - (*chunks)[*count - 1].tick;
+
+	if (*count == *capacity)
+	{
+		int capacity_needed = (*capacity > 0)? *capacity*2 : 64;
+		ReplayChunk* grown = (ReplayChunk*)SDL_realloc(*chunks, capacity_needed*sizeof(ReplayChunk));
+		if (grown == NULL) return;
+
+		*chunks = grown;
+		*capacity = capacity_needed;
+	}
+
+	(*chunks)[*count].tick = tick;
+	(*chunks)[*count].ticks = ticks;
+	(*chunks)[*count].offset = offset;
+	(*count)++;
+}
+
+static void FlushReplayChunk()
+{
+	if (chunk_ticks == 0) return;
+
+	const SimState zero = {};
+	Uint8 keyframe[MAX_SIM_DELTA_SIZE];
+	int keyframe_size = EncodeSimDelta(&chunk_keyframe, &zero, keyframe);
+
+	AddChunk(&chunk_index, &chunk_index_count, &chunk_index_capacity, chunk_tick, chunk_ticks, (Uint32)SDL_RWtell(recording));
+
+	SDL_WriteLE32(recording, CHUNK_MAGIC);
+	SDL_WriteLE32(recording, chunk_tick);
+	SDL_WriteLE16(recording, (Uint16)chunk_ticks);
+	SDL_WriteLE16(recording, (Uint16)keyframe_size);
+	SDL_WriteLE16(recording, (Uint16)chunk_actions_size);
+	SDL_WriteLE16(recording, (Uint16)(chunk_ticks*4));
+	SDL_RWwrite(recording, keyframe, 1, keyframe_size);
+	SDL_RWwrite(recording, chunk_actions, 1, chunk_actions_size);
+	for (int i = 0; i < chunk_ticks; ++i) SDL_WriteLE32(recording, chunk_hashes[i]);
+
+	chunk_ticks = 0;
+	chunk_actions_size = 0;
+}
+
+// Index of the chunk holding tick, -1 if none
+static int FindChunk(const Replay* replay, Uint32 tick)
+{
+	int low = 0;
+	int high = replay->chunk_count - 1;
+	int found = -1;
+
+	while (low <= high)
+	{
+		int middle = (low + high)/2;
+
+		if (replay->chunks[middle].tick <= tick)
+		{
+			found = middle;
+			low = middle + 1;
+		}
+		else high = middle - 1;
+	}
+
+	if ((found >= 0) && (tick - replay->chunks[found].tick >= replay->chunks[found].ticks)) found = -1;
+
+	return found;
+}
+
+// Chunk sections, checked against the replay bounds
+static bool GetChunkData(const Replay* replay, const ReplayChunk* chunk, ChunkData* sections)
+{
+	if ((size_t)chunk->offset + CHUNK_HEADER_SIZE > replay->size) return false;
+
+	const Uint8* data = replay->data + chunk->offset;
+	if (Read32(data) != CHUNK_MAGIC) return false;
+
+	sections->keyframe_size = Read16(data + 10);
+	sections->actions_size = Read16(data + 12);
+	sections->hash_count = Read16(data + 14)/4;
+	sections->keyframe = data + CHUNK_HEADER_SIZE;
+	sections->actions = sections->keyframe + sections->keyframe_size;
+	sections->hashes = sections->actions + sections->actions_size;
+
+	return ((size_t)chunk->offset + CHUNK_HEADER_SIZE + sections->keyframe_size + sections->actions_size + sections->hash_count*4 <= replay->size);
+}
+
+// Build the chunks list from the index at the end of the file
+static bool ReadIndex(Replay* replay)
+{
+	if (replay->size < HEADER_SIZE + FOOTER_SIZE) return false;
+
+	const Uint8* footer = replay->data + replay->size - FOOTER_SIZE;
+	if (Read32(footer + 8) != INDEX_MAGIC) return false;
+
+	Uint32 offset = Read32(footer);
+	Uint32 count = Read32(footer + 4);
+	if ((offset < HEADER_SIZE) || ((Uint64)offset + (Uint64)count*INDEX_ENTRY_SIZE != replay->size - FOOTER_SIZE)) return false;
+
+	int capacity = 0;
+	for (Uint32 i = 0; i < count; ++i)
+	{
+		const Uint8* entry = replay->data + offset + i*INDEX_ENTRY_SIZE;
+		AddChunk(&replay->chunks, &replay->chunk_count, &capacity, Read32(entry), Read32(entry + 4), Read32(entry + 8));
+	}
+
+	return true;
+}
+
+// No index (recording interrupted or still going), walk the chunks
+static void ScanChunks(Replay* replay)
+{
+	int capacity = 0;
+	size_t offset = HEADER_SIZE;
+
+	while (offset + CHUNK_HEADER_SIZE <= replay->size)
+	{
+		const Uint8* data = replay->data + offset;
+		if (Read32(data) != CHUNK_MAGIC) break;
+
+		size_t size = CHUNK_HEADER_SIZE + Read16(data + 10) + Read16(data + 12) + Read16(data + 14);
+		if (offset + size > replay->size) break;		// Chunk still being written
+
+		AddChunk(&replay->chunks, &replay->chunk_count, &capacity, Read32(data + 4), Read16(data + 8), (Uint32)offset);
+		offset += size;
+	}
+}
+
+static bool MapReplay(Replay* replay, const char* file_name)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	const void* view = NULL;
+
+	if (GetFileSizeEx(file, &size) && (size.QuadPart > 0)) mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == NULL)
+	{
+		if (mapping != NULL) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	replay->data = (const Uint8*)view;
+	replay->size = (size_t)size.QuadPart;
+	replay->file = file;
+	replay->mapping = mapping;
+#else
+	int file = open(file_name, O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat info;
+	void* view = MAP_FAILED;
+
+	if ((fstat(file, &info) == 0) && (info.st_size > 0)) view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED) return false;
+
+	replay->data = (const Uint8*)view;
+	replay->size = (size_t)info.st_size;
+#endif
+
+	replay->mapped = true;
+
+	return true;
+}
+
+// Fallback when the file can't be mapped
+static bool LoadReplay(Replay* replay, const char* file_name)
+{
+	SDL_RWops* file = SDL_RWFromFile(file_name, "rb");
+	if (file == NULL) return false;
+
+	Sint64 size = SDL_RWsize(file);
+	Uint8* data = (size > 0)? (Uint8*)SDL_malloc((size_t)size) : NULL;
+
+	if ((data != NULL) && (SDL_RWread(file, data, 1, (size_t)size) != (size_t)size))
+	{
+		SDL_free(data);
+		data = NULL;
+	}
+
+	SDL_RWclose(file);
+
+	replay->data = data;
+	replay->size = (size_t)size;
+
+	return (data != NULL);
+}
+
+// ----------------------------------------------------------------
+bool BeginReplayRecording(const char* file_name, Uint32 seed)
+{
+	if (recording != NULL) EndReplayRecording();
+
+	recording = SDL_RWFromFile(file_name, "wb");
+
+	if (recording == NULL)
+	{
+		printf("WARNING: Unable to write replay %s! SDL Error: %s\n", file_name, SDL_GetError());
+		return false;
+	}
+
+	SDL_WriteLE32(recording, REPLAY_MAGIC);
+	SDL_WriteLE16(recording, REPLAY_VERSION);
+	SDL_WriteLE16(recording, SIM_STATE_VERSION);
+	SDL_WriteLE16(recording, (Uint16)sizeof(SimState));
+	SDL_WriteLE16(recording, REPLAY_CHUNK_TICKS);
+	SDL_WriteLE32(recording, seed);
+
+	chunk_ticks = 0;
+	chunk_actions_size = 0;
+	chunk_index_count = 0;
+	ticks_recorded = 0;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void RecordReplayTick(const SimState* sim, Uint8 actions, Uint32 hash)
+{
+	if (recording == NULL) return;
+
+	if ((chunk_ticks > 0) && (sim->tick != next_tick)) FlushReplayChunk();
+
+	if (chunk_ticks == 0)
+	{
+		chunk_keyframe = *sim;
+		chunk_tick = sim->tick;
+	}
+
+	// Actions change a few times per second, repeat counts keep them small
+	if ((chunk_actions_size > 0) && (chunk_actions[chunk_actions_size - 1] == actions) && (chunk_actions[chunk_actions_size - 2] < 255)) chunk_actions[chunk_actions_size - 2]++;
+	else
+	{
+		chunk_actions[chunk_actions_size++] = 1;
+		chunk_actions[chunk_actions_size++] = actions;
+	}
+
+	chunk_hashes[chunk_ticks] = hash;
+	chunk_ticks++;
+	ticks_recorded++;
+	next_tick = sim->tick + 1;
+
+	if (chunk_ticks == REPLAY_CHUNK_TICKS) FlushReplayChunk();
+}
+
+// ----------------------------------------------------------------
+void EndReplayRecording()
+{
+	if (recording == NULL) return;
+
+	FlushReplayChunk();
+
+	Uint32 index_offset = (Uint32)SDL_RWtell(recording);
+
+	for (int i = 0; i < chunk_index_count; ++i)
+	{
+		SDL_WriteLE32(recording, chunk_index[i].tick);
+		SDL_WriteLE32(recording, chunk_index[i].ticks);
+		SDL_WriteLE32(recording, chunk_index[i].offset);
+	}
+
+	SDL_WriteLE32(recording, index_offset);
+	SDL_WriteLE32(recording, chunk_index_count);
+	SDL_WriteLE32(recording, INDEX_MAGIC);
+
+	printf("Replay: %u ticks recorded, %i chunks, %i bytes\n", ticks_recorded, chunk_index_count, (int)SDL_RWtell(recording));
+
+	SDL_RWclose(recording);
+	recording = NULL;
+
+	SDL_free(chunk_index);
+	chunk_index = NULL;
+	chunk_index_count = 0;
+	chunk_index_capacity = 0;
+}
+
+// ----------------------------------------------------------------
+bool OpenReplay(Replay* replay, const char* file_name)
+{
+	SDL_zerop(replay);
+
+	if (!MapReplay(replay, file_name) && !LoadReplay(replay, file_name))
+	{
+		printf("WARNING: Unable to read replay %s!\n", file_name);
+		return false;
+	}
+
+	const Uint8* header = replay->data;
+
+	if ((replay->size < HEADER_SIZE) || (Read32(header) != REPLAY_MAGIC) || (Read16(header + 4) != REPLAY_VERSION) ||
+		(Read16(header + 6) != SIM_STATE_VERSION) || (Read16(header + 8) != sizeof(SimState)))
+	{
+		printf("WARNING: %s is not a replay of this game version\n", file_name);
+		CloseReplay(replay);
+		return false;
+	}
+
+	replay->seed = Read32(header + 12);
+
+	if (!ReadIndex(replay))
+	{
+		printf("WARNING: Replay %s has no index, scanning it\n", file_name);
+		replay->chunk_count = 0;
+		ScanChunks(replay);
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void CloseReplay(Replay* replay)
+{
+	if (replay->data != NULL)
+	{
+		if (!replay->mapped) SDL_free((void*)replay->data);
+		else
+		{
+#if defined(_WIN32)
+			UnmapViewOfFile(replay->data);
+			CloseHandle((HANDLE)replay->mapping);
+			CloseHandle((HANDLE)replay->file);
+#else
+			munmap((void*)replay->data, replay->size);
+#endif
+		}
+	}
+
+	SDL_free(replay->chunks);
+	SDL_zerop(replay);
+}
+
+// ----------------------------------------------------------------
+Uint32 GetReplayFirstTick(const Replay* replay)
+{
+	return (replay->chunk_count > 0)? replay->chunks[0].tick : 0;
+}
+
+// ----------------------------------------------------------------
+Uint32 GetReplayEndTick(const Replay* replay)
+{
+	if (replay->chunk_count == 0) return 0;
+
+	const ReplayChunk* last = &replay->chunks[replay->chunk_count - 1];
+
+	return last->tick + last->ticks;
+}
+
+// ----------------------------------------------------------------
+bool SeekReplay(const Replay* replay, Uint32 tick, SimState* sim)
+{
+	// State after the last tick is reached from the last chunk too
+	int found = FindChunk(replay, tick);
+	if ((found < 0) && (replay->chunk_count > 0) && (tick == GetReplayEndTick(replay))) found = replay->chunk_count - 1;
+	if (found < 0) return false;
+
+	const ReplayChunk* chunk = &replay->chunks[found];
+	ChunkData data;
+
+	if (!GetChunkData(replay, chunk, &data)) return false;
+
+	SimState state = {};
+	if (!ApplySimDelta(data.keyframe, data.keyframe_size, &state) || (state.tick != chunk->tick)) return false;
+
+	// Simulate from the keyframe, audio is not wanted when seeking
+	for (int i = 0; (i + 1 < data.actions_size) && (state.tick < tick); i += 2)
+	{
+		for (int repeat = 0; (repeat < data.actions[i]) && (state.tick < tick); ++repeat) MoveStuff(&state, data.actions[i + 1], NULL);
+	}
+
+	if (state.tick != tick) return false;
+
+	*sim = state;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+bool GetReplayActions(const Replay* replay, Uint32 tick, Uint8* actions)
+{
+	int found = FindChunk(replay, tick);
+	if (found < 0) return false;
+
+	const ReplayChunk* chunk = &replay->chunks[found];
+	ChunkData data;
+
+	if (!GetChunkData(replay, chunk, &data)) return false;
+
+	Uint32 skip = tick - chunk->tick;
+
+	for (int i = 0; i + 1 < data.actions_size; i += 2)
+	{
+		if (skip < data.actions[i])
+		{
+			*actions = data.actions[i + 1];
+			return true;
+		}
+
+		skip -= data.actions[i];
+	}
+
+	return false;
+}
+
+// ----------------------------------------------------------------
+bool GetReplayHash(const Replay* replay, Uint32 tick, Uint32* hash)
+{
+	int found = FindChunk(replay, tick);
+	if (found < 0) return false;
+
+	const ReplayChunk* chunk = &replay->chunks[found];
+	ChunkData data;
+
+	if (!GetChunkData(replay, chunk, &data) || ((int)(tick - chunk->tick) >= data.hash_count)) return false;
+
+	*hash = Read32(data.hashes + (tick - chunk->tick)*4);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+bool CheckReplay(const char* file_name)
+{
+	Replay replay;
+	if (!OpenReplay(&replay, file_name)) return false;
+
+	Uint32 first = GetReplayFirstTick(&replay);
+	Uint32 end = GetReplayEndTick(&replay);
+	SimState sim;
+
+	if (!SeekReplay(&replay, first, &sim))
+	{
+		printf("Check: %s has no ticks to check\n", file_name);
+		CloseReplay(&replay);
+		return false;
+	}
+
+	Uint32 diverged = 0;
+	bool same = true;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (int c = 0; c < replay.chunk_count; ++c)
+	{
+		const ReplayChunk* chunk = &replay.chunks[c];
+
+		// Every keyframe is a full state to compare with
+		SimState keyframe;
+		if (SeekReplay(&replay, chunk->tick, &keyframe) && (HashSim(&sim) != HashSim(&keyframe)))
+		{
+			if (same) printf("Check: state differs from the keyframe at tick %u\n", chunk->tick);
+			else printf("Check: fields differing at tick %u, next keyframe after the first desync:\n", chunk->tick);
+
+			PrintSimDiff(&sim, &keyframe);
+			if (!same) break;
+
+			same = false;
+			diverged = chunk->tick;
+			sim = keyframe;
+		}
+
+		for (Uint32 tick = chunk->tick; tick < chunk->tick + chunk->ticks; ++tick)
+		{
+			Uint8 actions = 0;
+			Uint32 hash = 0;
+
+			GetReplayActions(&replay, tick, &actions);
+			MoveStuff(&sim, actions, NULL);
+
+			if (same && GetReplayHash(&replay, tick, &hash) && (HashSim(&sim) != hash))
+			{
+				printf("Check: desync at tick %u, hash %08X, expected %08X\n", tick, HashSim(&sim), hash);
+				same = false;
+				diverged = tick;
+			}
+		}
+
+		if (!same && (c + 1 == replay.chunk_count)) printf("Check: no keyframe after the desync to compare fields with\n");
+	}
+
+	double ms = (SDL_GetPerformanceCounter() - start)*1000.0/SDL_GetPerformanceFrequency();
+
+	if (same) printf("Check: %s matches, %u ticks in %.1f ms, final hash %08X\n", file_name, end - first, ms, HashSim(&sim));
+	else printf("Check: %s diverges at tick %u\n", file_name, diverged);
+
+	CloseReplay(&replay);
+
+	return same;
+}
@@ -0,0 +1,81 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Replay - Recorded sessions with a keyframe index for fast seeking
+//
+// A replay is the actions held every tick, split in chunks that start
+// with the full state (a keyframe), so reaching any tick only needs to
+// simulate from the chunk start. File layout, all values little endian:
+//
+//   Header   magic "RPLY", version, SimState version and size, chunk ticks, seed
+//   Chunk    magic "CHNK", first tick, ticks, keyframe size, actions size, hashes size,
+//            keyframe (SimState delta against a zeroed state, see Rewind.h),
+//            actions as [repeat count][actions] pairs,
+//            HashSim() of the state after every tick
+//   ...      one chunk every REPLAY_CHUNK_TICKS, written as they fill up
+//   Index    first tick, ticks and file offset of every chunk
+//   Footer   index offset, chunk count, magic "RIDX"
+//
+// Chunks stand on their own: a replay whose footer is missing (recording
+// interrupted, still being written) is read by scanning them in order.
+// Replays are memory mapped for reading.
+// -------------------------------------------------------------------------
+
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+
+#define REPLAY_VERSION		   2
+#define REPLAY_CHUNK_TICKS	(5*SIM_TICK_RATE)	// Ticks between keyframes
+
+struct ReplayChunk
+{
+	Uint32 tick;			// First tick, keyframe is the state before it
+	Uint32 ticks;
+	Uint32 offset;
+};
+
+// Replay opened for reading, fields are read only
+struct Replay
+{
+	const Uint8* data;
+	size_t size;
+	Uint32 seed;
+	ReplayChunk* chunks;	// Sorted by tick
+	int chunk_count;
+
+	void* file;				// Platform mapping handles
+	void* mapping;
+	bool mapped;			// Otherwise data was read into memory
+};
+
+// Recording, one at a time: record every tick the state before it, the actions held and the hash after it
+// NOTE: Going back in time (rewind, snapshot load) starts a new chunk, later chunks are dropped from the index
+bool BeginReplayRecording(const char* file_name, Uint32 seed);
+void RecordReplayTick(const SimState* sim, Uint8 actions, Uint32 hash);
+// Write pending ticks, index and footer
+void EndReplayRecording();
+
+bool OpenReplay(Replay* replay, const char* file_name);
+void CloseReplay(Replay* replay);
+
+// First tick and tick after the last one recorded
+Uint32 GetReplayFirstTick(const Replay* replay);
+Uint32 GetReplayEndTick(const Replay* replay);
+
+// State before tick: chunk keyframe, then up to REPLAY_CHUNK_TICKS ticks simulated without audio
+bool SeekReplay(const Replay* replay, Uint32 tick, SimState* sim);
+
+// Actions held on tick, false if tick was not recorded
+bool GetReplayActions(const Replay* replay, Uint32 tick, Uint8* actions);
+
+// HashSim() of the state after tick, false if tick was not recorded
+bool GetReplayHash(const Replay* replay, Uint32 tick, Uint32* hash);
+
+// Simulate the whole replay again, comparing every tick hash and every keyframe
+// Reports the first tick that differs and the fields differing at the next keyframe
+bool CheckReplay(const char* file_name);
+
+#endif // __REPLAY_H__
@@ -0,0 +1,282 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Rewind - Simulation snapshots and rewind ring buffer
+// -------------------------------------------------------------------------
+
+#include "Rewind.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#define SNAPSHOT_MAGIC		0x534D4953		// "SIMS"
+
+struct RewindEntry
+{
+	Uint32 tick;
+	Uint32 offset;			// Encoded delta position in buffer
+	Uint16 size;
+	bool keyframe;
+};
+
+static RewindEntry entries[REWIND_TICKS];
+static int first = 0;				// Oldest entry
+static int count = 0;
+static Uint8 buffer[REWIND_BUFFER_SIZE];
+static Uint32 head = 0;				// Next write position in buffer
+static SimState last;				// State recorded last, deltas are against it
+static const SimState zero = {};	// Keyframes base
+
+static int recorded = 0;
+static int rewinds = 0;
+static Uint64 delta_bytes = 0;
+static int delta_count = 0;
+
+static RewindEntry* Entry(int index)
+{
+	return &entries[(first + index)%REWIND_TICKS];
+}
+
+static void DropOldest()
+{
+	first = (first + 1)%REWIND_TICKS;
+	count--;
+}
+
+// Index of the entry recorded at tick, -1 if not kept
+static int FindEntry(Uint32 tick)
+{
+	if ((count == 0) || (tick < Entry(0)->tick)) return -1;
+
+	// Ticks are consecutive, as long as no tick was recorded twice
+	int index = (int)(tick - Entry(0)->tick);
+	if ((index < count) && (Entry(index)->tick == tick)) return index;
+
+	for (int i = count - 1; i >= 0; --i) if (Entry(i)->tick == tick) return i;
+
+	return -1;
+}
+
+// ----------------------------------------------------------------
+int EncodeSimDelta(const SimState* sim, const SimState* base, Uint8* out)
+{
+	const Uint8* state = (const Uint8*)sim;
+	const Uint8* previous = (const Uint8*)base;
+	int size = 0;
+	int i = 0;
+
+	// [zero run][literal run][literals]... up to the end of the state
+	while (i < (int)sizeof(SimState))
+	{
+		int zeros = 0;
+		while ((i < (int)sizeof(SimState)) && (zeros < 255) && (state[i] == previous[i])) { zeros++; i++; }
+
+		int literals = 0;
+		Uint8* run = &out[size + 2];
+		while ((i < (int)sizeof(SimState)) && (literals < 255) && (state[i] != previous[i])) { run[literals++] = state[i] ^ previous[i]; i++; }
+
+		out[size] = (Uint8)zeros;
+		out[size + 1] = (Uint8)literals;
+		size += 2 + literals;
+	}
+
+	return size;
+}
+
+// ----------------------------------------------------------------
+bool ApplySimDelta(const Uint8* delta, int size, SimState* sim)
+{
+	Uint8* state = (Uint8*)sim;
+	int i = 0;
+
+	for (int d = 0; d < size; )
+	{
+		if (d + 2 > size) return false;
+
+		i += delta[d];
+		int literals = delta[d + 1];
+		d += 2;
+
+		// NOTE: Deltas may come from files, never write past the state
+		if ((i + literals > (int)sizeof(SimState)) || (d + literals > size)) return false;
+
+		for (int k = 0; k < literals; ++k) state[i++] ^= delta[d++];
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+bool SaveSimSnapshot(const SimState* sim, const char* file_name)
+{
+	SDL_RWops* file = SDL_RWFromFile(file_name, "wb");
+
+	if (file == NULL)
+	{
+		printf("WARNING: Unable to write snapshot %s! SDL Error: %s\n", file_name, SDL_GetError());
+		return false;
+	}
+
+	// NOTE: State bytes are written as they are in memory, snapshots are not portable across endianness
+	SDL_WriteLE32(file, SNAPSHOT_MAGIC);
+	SDL_WriteLE16(file, SIM_STATE_VERSION);
+	SDL_WriteLE16(file, (Uint16)sizeof(SimState));
+	bool written = (SDL_RWwrite(file, sim, sizeof(SimState), 1) == 1);
+	SDL_RWclose(file);
+
+	if (!written) printf("WARNING: Unable to write snapshot %s! SDL Error: %s\n", file_name, SDL_GetError());
+
+	return written;
+}
+
+// ----------------------------------------------------------------
+bool LoadSimSnapshot(SimState* sim, const char* file_name)
+{
+	SDL_RWops* file = SDL_RWFromFile(file_name, "rb");
+
+	if (file == NULL)
+	{
+		printf("WARNING: Unable to read snapshot %s! SDL Error: %s\n", file_name, SDL_GetError());
+		return false;
+	}
+
+	Uint32 magic = SDL_ReadLE32(file);
+	Uint16 version = SDL_ReadLE16(file);
+	Uint16 size = SDL_ReadLE16(file);
+	bool loaded = false;
+
+	if ((magic != SNAPSHOT_MAGIC) || (version != SIM_STATE_VERSION) || (size != sizeof(SimState)))
+	{
+		printf("WARNING: Snapshot %s is version %i (%i bytes), expected version %i (%i bytes)\n",
+			file_name, version, size, SIM_STATE_VERSION, (int)sizeof(SimState));
+	}
+	else
+	{
+		// Read into a copy, a short file must not leave the state half loaded
+		SimState loaded_sim;
+		loaded = (SDL_RWread(file, &loaded_sim, sizeof(SimState), 1) == 1);
+
+		if (loaded) *sim = loaded_sim;
+		else printf("WARNING: Snapshot %s is truncated\n", file_name);
+	}
+
+	SDL_RWclose(file);
+
+	return loaded;
+}
+
+// ----------------------------------------------------------------
+void InitRewind()
+{
+	first = 0;
+	count = 0;
+	head = 0;
+	recorded = 0;
+	rewinds = 0;
+	delta_bytes = 0;
+	delta_count = 0;
+	last = zero;
+}
+
+// ----------------------------------------------------------------
+void RecordRewind(const SimState* sim)
+{
+	Uint8 delta[MAX_SIM_DELTA_SIZE];
+
+	bool keyframe = (count == 0) || (sim->tick%REWIND_KEYFRAME_TICKS == 0);
+	int size = EncodeSimDelta(sim, keyframe? &zero : &last, delta);
+
+	// No room left before the end: the oldest entries are the ones after head, drop them and wrap
+	if (head + size > REWIND_BUFFER_SIZE)
+	{
+		while ((count > 0) && (Entry(0)->offset >= head)) DropOldest();
+		head = 0;
+	}
+
+	// Drop the oldest entries the new one overwrites, or the oldest tick when all are used
+	while ((count > 0) && (Entry(0)->offset < head + size) && (Entry(0)->offset + Entry(0)->size > head)) DropOldest();
+	if (count == REWIND_TICKS) DropOldest();
+
+	RewindEntry* entry = Entry(count++);
+	entry->tick = sim->tick;
+	entry->offset = head;
+	entry->size = (Uint16)size;
+	entry->keyframe = keyframe;
+
+	SDL_memcpy(&buffer[head], delta, size);
+	head += size;
+	last = *sim;
+
+	recorded++;
+	if (!keyframe)
+	{
+		delta_bytes += size;
+		delta_count++;
+	}
+}
+
+// ----------------------------------------------------------------
+bool GetRewindState(Uint32 tick, SimState* sim)
+{
+	int index = FindEntry(tick);
+	if (index < 0) return false;
+
+	int keyframe = index;
+	while ((keyframe >= 0) && !Entry(keyframe)->keyframe) keyframe--;
+
+	// Keyframe already dropped, deltas alone can't rebuild the state
+	if (keyframe < 0) return false;
+
+	SimState state = zero;
+	for (int i = keyframe; i <= index; ++i) ApplySimDelta(&buffer[Entry(i)->offset], Entry(i)->size, &state);
+
+	*sim = state;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+bool RewindTo(Uint32 tick, SimState* sim)
+{
+	int index = FindEntry(tick);
+	if ((index < 0) || !GetRewindState(tick, sim)) return false;
+
+	// Later ticks belong to the abandoned run
+	count = index + 1;
+	head = Entry(index)->offset + Entry(index)->size;
+	last = *sim;
+	rewinds++;
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+Uint32 GetRewindOldestTick()
+{
+	for (int i = 0; i < count; ++i) if (Entry(i)->keyframe) return Entry(i)->tick;
+
+	return (count > 0)? Entry(count - 1)->tick + 1 : 0;
+}
+
+// ----------------------------------------------------------------
+RewindStats GetRewindStats()
+{
+	RewindStats stats;
+
+	stats.ticks = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (Entry(i)->keyframe)
+		{
+			stats.ticks = count - i;
+			break;
+		}
+	}
+
+	stats.bytes = 0;
+	for (int i = 0; i < count; ++i) stats.bytes += Entry(i)->size;
+
+	stats.recorded = recorded;
+	stats.avg_delta = (delta_count > 0)? (float)delta_bytes/delta_count : 0.0f;
+	stats.rewinds = rewinds;
+
+	return stats;
+}
@@ -0,0 +1,63 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Rewind - Simulation snapshots and rewind ring buffer
+//
+// Snapshot files are a small versioned header followed by SimState as is.
+//
+// Every tick the state is XORed against the previous one and the result
+// run-length encoded (zero runs and literal runs), so unchanged bytes
+// cost almost nothing. A keyframe (delta against an all zero state) every
+// REWIND_KEYFRAME_TICKS bounds the deltas to apply to restore a tick.
+// Oldest ticks are dropped when the ring runs out of ticks or bytes.
+// -------------------------------------------------------------------------
+
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+
+#define REWIND_TICKS			(10*SIM_TICK_RATE)		// Ticks kept, 10 seconds
+#define REWIND_KEYFRAME_TICKS	SIM_TICK_RATE
+#define REWIND_BUFFER_SIZE		(128*1024)				// Encoded bytes kept
+
+#define MAX_SIM_DELTA_SIZE		(2*sizeof(SimState) + 2)	// Worst case, alternating runs
+
+struct RewindStats
+{
+	int ticks;				// Ticks currently restorable
+	int bytes;				// Encoded bytes in use
+	int recorded;			// Ticks recorded in total
+	float avg_delta;		// Average encoded delta size, keyframes excluded
+	int rewinds;
+};
+
+// Binary snapshot, refused if written by a different SimState version
+bool SaveSimSnapshot(const SimState* sim, const char* file_name);
+bool LoadSimSnapshot(SimState* sim, const char* file_name);
+
+// XOR sim against base and run-length encode it, returns the bytes written to out
+// NOTE: Encode against a zeroed state for a delta that stands on its own
+int EncodeSimDelta(const SimState* sim, const SimState* base, Uint8* out);
+// XOR a delta back into the state it was encoded against, false if it is malformed
+bool ApplySimDelta(const Uint8* delta, int size, SimState* sim);
+
+void InitRewind();
+
+// Append the state reached this tick, call it once per tick
+void RecordRewind(const SimState* sim);
+
+// Rebuild the state recorded at tick, false if no longer (or not yet) kept
+bool GetRewindState(Uint32 tick, SimState* sim);
+
+// Restore the state recorded at tick and forget every later one,
+// so the run goes on (forks) from there
+bool RewindTo(Uint32 tick, SimState* sim);
+
+// Oldest tick GetRewindState() can rebuild
+Uint32 GetRewindOldestTick();
+
+RewindStats GetRewindStats();
+
+#endif // __REWIND_H__
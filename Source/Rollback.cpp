@@ -0,0 +1,268 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Rollback - Two players netplay with input prediction and rollback
+// -------------------------------------------------------------------------
+
+#include "Rollback.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#define PACKET_HELLO		   1
+#define PACKET_ACTIONS		   2
+
+#define HELLO_SIZE			   8		// type, player, SimState version, seed
+#define ACTIONS_HEADER_SIZE	  18		// type, count, first tick, ack, sync tick, sync hash
+
+#define NO_ROLLBACK			0xFFFFFFFFu
+#define NO_HASH				0xFFFFFFFFu
+
+// Actions a player controls, quit stays local
+#define PLAYER_ACTIONS		(ACTION_BIT(ACTION_MOVE_LEFT) | ACTION_BIT(ACTION_MOVE_RIGHT) | ACTION_BIT(ACTION_CONFIRM))
+
+static int Slot(Uint32 tick)
+{
+	return (int)(tick & (ROLLBACK_WINDOW - 1));
+}
+
+static void WriteLE32(Uint8* data, Uint32 value)
+{
+	value = SDL_SwapLE32(value);
+	SDL_memcpy(data, &value, 4);
+}
+
+static Uint32 ReadLE32(const Uint8* data)
+{
+	Uint32 value;
+	SDL_memcpy(&value, data, 4);
+	return SDL_SwapLE32(value);
+}
+
+static void SendHello(RollbackSession* session)
+{
+	Uint8 packet[HELLO_SIZE];
+
+	packet[0] = PACKET_HELLO;
+	packet[1] = (Uint8)session->player;
+	packet[2] = (Uint8)(SIM_STATE_VERSION & 0xFF);
+	packet[3] = (Uint8)(SIM_STATE_VERSION >> 8);
+	WriteLE32(&packet[4], session->seed);
+
+	NetSend(session->transport, packet, HELLO_SIZE);
+}
+
+// Every local action the peer has not acknowledged, and the last confirmed state hash
+static void SendActions(RollbackSession* session)
+{
+	Uint8 packet[ACTIONS_HEADER_SIZE + ROLLBACK_WINDOW];
+	int count = (int)SDL_min(session->local_end - session->acked, (Uint32)ROLLBACK_WINDOW);
+	Uint32 first = session->local_end - count;
+
+	packet[0] = PACKET_ACTIONS;
+	packet[1] = (Uint8)count;
+	WriteLE32(&packet[2], first);
+	WriteLE32(&packet[6], session->remote_end);
+	WriteLE32(&packet[10], session->sync_tick);
+	WriteLE32(&packet[14], session->hashes[Slot(session->sync_tick)]);
+
+	for (int i = 0; i < count; ++i) packet[ACTIONS_HEADER_SIZE + i] = session->local[Slot(first + i)];
+
+	NetSend(session->transport, packet, ACTIONS_HEADER_SIZE + count);
+}
+
+static void ReceiveHello(RollbackSession* session, const Uint8* packet, int size)
+{
+	if (size < HELLO_SIZE) return;
+
+	int player = packet[1];
+	int version = packet[2] | (packet[3] << 8);
+
+	if (player == session->player) return;
+
+	if (version != SIM_STATE_VERSION)
+	{
+		if (!session->connected) printf("WARNING: Peer simulation is version %i, expected version %i\n", version, SIM_STATE_VERSION);
+		return;
+	}
+
+	// Host answers every hello, its answer may be lost too
+	if (session->player == 0) SendHello(session);
+	else if (!session->connected) session->seed = ReadLE32(&packet[4]);
+
+	session->connected = true;
+}
+
+static void ReceiveActions(RollbackSession* session, Uint32 tick, const Uint8* packet, int size)
+{
+	if (size < ACTIONS_HEADER_SIZE) return;
+
+	int count = SDL_min((int)packet[1], size - ACTIONS_HEADER_SIZE);
+	Uint32 first = ReadLE32(&packet[2]);
+	Uint32 ack = ReadLE32(&packet[6]);
+	Uint32 sync_tick = ReadLE32(&packet[10]);
+	Uint32 sync_hash = ReadLE32(&packet[14]);
+
+	// NOTE: Packets arrive out of order, acknowledgements and actions only move forward
+	if ((ack > session->acked) && (ack <= session->local_end)) session->acked = ack;
+
+	for (int i = 0; i < count; ++i)
+	{
+		Uint32 action_tick = first + i;
+
+		if (action_tick < session->remote_end) continue;
+		if ((action_tick > session->remote_end) || (action_tick >= tick + ROLLBACK_WINDOW/2)) break;
+
+		Uint8 actions = packet[ACTIONS_HEADER_SIZE + i] & PLAYER_ACTIONS;
+		session->remote[Slot(action_tick)] = actions;
+		session->remote_end++;
+
+		// Already simulated with a prediction, the earliest wrong one is where to go back
+		if ((action_tick < tick) && (session->used[Slot(action_tick)] != actions) && (action_tick < session->rollback_tick))
+		{
+			session->rollback_tick = action_tick;
+		}
+	}
+
+	// Compare states both peers confirmed, report the first one that differs
+	int slot = Slot(sync_tick);
+	if ((sync_tick != NO_HASH) && (session->hash_ticks[slot] == sync_tick) && (session->hashes[slot] != sync_hash) && !session->stats.desync)
+	{
+		printf("WARNING: Netplay desync at tick %u, hash %08X, peer hash %08X\n", sync_tick, session->hashes[slot], sync_hash);
+		session->stats.desync = true;
+		session->stats.desync_tick = sync_tick;
+	}
+}
+
+static void ReceivePackets(RollbackSession* session, Uint32 tick)
+{
+	Uint8 packet[NET_MAX_PACKET];
+	int size = 0;
+
+	while ((size = NetReceive(session->transport, packet, NET_MAX_PACKET)) > 0)
+	{
+		if (packet[0] == PACKET_HELLO) ReceiveHello(session, packet, size);
+		else if (packet[0] == PACKET_ACTIONS) ReceiveActions(session, tick, packet, size);
+	}
+}
+
+// Simulate one tick with the remote actions received, or predicted as held since the last ones
+static Uint32 SimulateTick(RollbackSession* session, SimState* sim, AudioCommandList* audio)
+{
+	Uint32 tick = sim->tick;
+	int slot = Slot(tick);
+	Uint8 remote = (tick < session->remote_end)? session->remote[slot] : session->remote[Slot(session->remote_end - 1)];
+
+	session->states[slot] = *sim;
+	session->used[slot] = remote;
+
+	Uint32 actions = (session->local[slot] << (session->player*PLAYER_ACTION_BITS)) | (remote << ((1 - session->player)*PLAYER_ACTION_BITS));
+
+	return MoveStuff(sim, actions, audio);
+}
+
+// Back to the state before the first misprediction, then every tick again with the actions known now
+static void Rollback(RollbackSession* session, SimState* sim)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint32 end = sim->tick;
+	int ticks = (int)(end - session->rollback_tick);
+
+	*sim = session->states[Slot(session->rollback_tick)];
+	while (sim->tick < end) SimulateTick(session, sim, NULL);
+
+	Uint64 time = SDL_GetPerformanceCounter() - start;
+	float ms = (float)(time*1000.0/SDL_GetPerformanceFrequency());
+
+	session->rollback_time += time;
+	session->stats.rollbacks++;
+	session->stats.resimulated += ticks;
+	if (ticks > session->stats.max_resimulated) session->stats.max_resimulated = ticks;
+	if (ms > session->stats.max_rollback_ms) session->stats.max_rollback_ms = ms;
+
+	session->rollback_tick = NO_ROLLBACK;
+}
+
+// Every action before remote_end is known, so is the state before it once simulated
+static void UpdateSyncHash(RollbackSession* session, const SimState* sim)
+{
+	Uint32 tick = SDL_min(session->remote_end, sim->tick);
+	if (tick == session->sync_tick) return;
+
+	int slot = Slot(tick);
+	session->sync_tick = tick;
+	session->hash_ticks[slot] = tick;
+	session->hashes[slot] = HashSim((tick == sim->tick)? sim : &session->states[slot]);
+}
+
+// ----------------------------------------------------------------
+void InitRollback(RollbackSession* session, NetTransport* transport, int player, Uint32 seed)
+{
+	SDL_zerop(session);
+
+	session->transport = transport;
+	session->player = player;
+	session->seed = seed;
+	session->rollback_tick = NO_ROLLBACK;
+	session->sync_tick = NO_HASH;
+	for (int i = 0; i < ROLLBACK_WINDOW; ++i) session->hash_ticks[i] = NO_HASH;
+
+	// First ticks run before any action could apply, both peers know they are empty
+	session->local_end = ROLLBACK_INPUT_DELAY;
+	session->remote_end = ROLLBACK_INPUT_DELAY;
+}
+
+// ----------------------------------------------------------------
+bool ConnectRollback(RollbackSession* session)
+{
+	ReceivePackets(session, 0);
+
+	// Joiner keeps asking until the host answers
+	if ((session->player == 1) && !session->connected) SendHello(session);
+
+	return session->connected;
+}
+
+// ----------------------------------------------------------------
+bool RollbackTick(RollbackSession* session, SimState* sim, Uint8 actions, AudioCommandList* audio, Uint32* reflected)
+{
+	*reflected = 0;
+
+	ReceivePackets(session, sim->tick);
+
+	if (session->rollback_tick < sim->tick) Rollback(session, sim);
+	session->rollback_tick = NO_ROLLBACK;
+
+	UpdateSyncHash(session, sim);
+
+	// Too far ahead of the peer, a late action could need more ticks simulated again than allowed
+	bool advance = (sim->tick < session->remote_end + ROLLBACK_MAX_TICKS);
+
+	if (advance)
+	{
+		session->local[Slot(sim->tick + ROLLBACK_INPUT_DELAY)] = actions & PLAYER_ACTIONS;
+		session->local_end = sim->tick + ROLLBACK_INPUT_DELAY + 1;
+
+		Uint32 changed = SimulateTick(session, sim, audio);
+		*reflected = (changed >> (session->player*PLAYER_ACTION_BITS)) & PLAYER_ACTIONS;
+
+		session->stats.ticks++;
+	}
+	else session->stats.stalls++;
+
+	SendActions(session);
+
+	return advance;
+}
+
+// ----------------------------------------------------------------
+RollbackStats GetRollbackStats(const RollbackSession* session)
+{
+	RollbackStats stats = session->stats;
+
+	stats.avg_rollback_ms = (stats.rollbacks > 0)? (float)(session->rollback_time*1000.0/SDL_GetPerformanceFrequency()/stats.rollbacks) : 0.0f;
+	stats.packets_sent = session->transport->stats.sent;
+	stats.packets_received = session->transport->stats.received;
+	stats.packets_dropped = session->transport->stats.dropped;
+
+	return stats;
+}
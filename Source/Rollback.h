@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Rollback - Two players netplay with input prediction and rollback
+//
+// Both peers run the same deterministic simulation, only actions travel.
+// Local actions apply ROLLBACK_INPUT_DELAY ticks later and the remote ones
+// are predicted (held as last received) until they arrive, so neither
+// player waits for the network. When an action arrives that differs from
+// the prediction, the state saved before that tick is restored and the
+// ticks since then simulated again. The simulation never runs more than
+// ROLLBACK_MAX_TICKS ticks ahead of the remote actions received, that is
+// the most a rollback ever simulates again in a single tick.
+//
+// Packets carry every action the peer has not acknowledged yet, so a lost
+// packet is covered by the next one, and the hash of the last state both
+// peers agree on, to detect desyncs.
+// -------------------------------------------------------------------------
+
+#ifndef __ROLLBACK_H__
+#define __ROLLBACK_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+#include "Net.h"
+
+#define ROLLBACK_INPUT_DELAY	   2		// Ticks between a local action and the tick it applies to
+#define ROLLBACK_MAX_TICKS		   8		// Ticks simulated again at most, the session stalls beyond
+#define ROLLBACK_WINDOW			  64		// Ticks of actions, states and hashes kept (power of two)
+
+static_assert(ROLLBACK_WINDOW >= 2*(ROLLBACK_MAX_TICKS + ROLLBACK_INPUT_DELAY + 1), "Rollback window too small to cover unacknowledged actions");
+
+struct RollbackStats
+{
+	int ticks;					// Ticks advanced, not counting the ones simulated again
+	int stalls;					// Ticks waited for remote actions
+	int rollbacks;				// Mispredictions corrected
+	int resimulated;			// Ticks simulated again, in total
+	int max_resimulated;		// In a single rollback
+	float avg_rollback_ms;
+	float max_rollback_ms;
+	int packets_sent;
+	int packets_received;
+	int packets_dropped;		// By the injected loss
+	bool desync;				// Peers confirmed different states
+	Uint32 desync_tick;			// First confirmed state that differs, the one before this tick
+};
+
+struct RollbackSession
+{
+	NetTransport* transport;
+	int player;					// Local player, its actions go in bits player*PLAYER_ACTION_BITS
+	bool connected;
+	Uint32 seed;				// Player 0 picks it, player 1 adopts it on connect
+
+	Uint8 local[ROLLBACK_WINDOW];		// Local actions, by tick
+	Uint8 remote[ROLLBACK_WINDOW];		// Remote actions received, by tick
+	Uint8 used[ROLLBACK_WINDOW];		// Remote actions the last simulation of a tick used
+	SimState states[ROLLBACK_WINDOW];	// State before tick
+	Uint32 hash_ticks[ROLLBACK_WINDOW];	// Confirmed states hashes, tagged with their tick
+	Uint32 hashes[ROLLBACK_WINDOW];
+
+	Uint32 local_end;			// Tick after the last local action
+	Uint32 remote_end;			// Tick after the last remote action, all before it were received
+	Uint32 acked;				// Local actions before it reached the peer
+	Uint32 rollback_tick;		// Earliest tick simulated with a wrong prediction, 0xFFFFFFFF if none
+	Uint32 sync_tick;			// Last state both peers agree on, the one before it
+
+	RollbackStats stats;
+	Uint64 rollback_time;		// Performance counter ticks spent simulating again
+};
+
+// Player 0 hosts and picks the seed, player 1 joins and adopts it
+void InitRollback(RollbackSession* session, NetTransport* transport, int player, Uint32 seed);
+
+// Exchange hellos until both peers agree on the seed, call it every tick until it returns true
+bool ConnectRollback(RollbackSession* session);
+
+// Receive actions, roll back if any prediction was wrong, then advance sim one tick
+// with the local actions (player 1 ones, see Input.h) unless too far ahead of the peer
+// Returns false when stalled, reflected gets the local actions that changed the game
+// NOTE: Ticks simulated again don't queue audio, sounds already played stay played
+bool RollbackTick(RollbackSession* session, SimState* sim, Uint8 actions, AudioCommandList* audio, Uint32* reflected);
+
+RollbackStats GetRollbackStats(const RollbackSession* session);
+
+#endif // __ROLLBACK_H__
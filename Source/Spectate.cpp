@@ -0,0 +1,780 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Spectate - Live game broadcast to spectators over TCP
+// -------------------------------------------------------------------------
+
+#include "Spectate.h"
+#include "Net.h"
+#include "Bot.h"
+#include "Input.h"
+
+#include <stdio.h>			// Required for: printf()
+
+#define SPECTATE_MAGIC		0x43455053		// "SPEC"
+#define STREAM_HEADER_SIZE	   6
+#define CHECK_TICKS			(120*SIM_TICK_RATE)
+#define CHECK_SPECTATORS	   2		// One from the start, one joining halfway
+#define CHECK_DRAIN_MS		1000		// Wait for the last ticks to arrive
+
+// Message fields, in the order they follow the mask
+#define VIEW_TICK			0x01
+#define VIEW_SCREEN			0x02
+#define VIEW_PLAYERS		0x04		// players, ships alive and ship y
+#define VIEW_SHIPS			0x08
+#define VIEW_SCROLL			0x10
+#define VIEW_ALIVE			0x20
+#define VIEW_SHOTS			0x40		// Asteroids whose position the model missed
+#define VIEW_KEYFRAME		0x80
+
+struct Spectator
+{
+	NetStream stream;
+	int pending;
+	Uint8 buffer[SPECTATOR_BUFFER];
+};
+
+// Broadcast
+static NetStream listener = NET_NO_STREAM;
+static Spectator* spectators[MAX_SPECTATORS];
+static SpectatorView view;				// What every spectator has, messages go against it
+static bool has_view = false;
+static BroadcastStats stats;
+
+// Receiving end of a broadcast, spectating has one, the check several
+struct Watcher
+{
+	NetStream source;
+	Uint8 received[SPECTATOR_BUFFER];
+	int received_size;
+	int decoded;				// Bytes of received already decoded
+	bool header_read;
+	bool has_keyframe;
+	SpectatorView view;
+	BroadcastStats stats;
+};
+
+// Spectating
+static Watcher watching = { NET_NO_STREAM };
+
+static const SpectatorView empty = {};
+
+static int Quantize(int value)
+{
+	// NOTE: Rounds down, negative values too
+	return (value - ((value < 0)? SPECTATE_QUANTUM - 1 : 0))/SPECTATE_QUANTUM;
+}
+
+static Uint32 ZigZag(int value)
+{
+	return ((Uint32)value << 1) ^ (Uint32)(value >> 31);
+}
+
+static int UnZigZag(Uint32 value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static int PutVarint(Uint8* out, Uint32 value)
+{
+	int size = 0;
+
+	while (value >= 0x80)
+	{
+		out[size++] = (Uint8)(value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = (Uint8)value;
+
+	return size;
+}
+
+// Reads at *offset and moves it, false if the data ends first
+static bool GetVarint(const Uint8* data, int size, int* offset, Uint32* value)
+{
+	*value = 0;
+
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (*offset >= size) return false;
+
+		Uint8 byte = data[(*offset)++];
+		*value |= (Uint32)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+
+	return false;
+}
+
+static bool GetSigned(const Uint8* data, int size, int* offset, int* value)
+{
+	Uint32 raw;
+	if (!GetVarint(data, size, offset, &raw)) return false;
+
+	*value = UnZigZag(raw);
+
+	return true;
+}
+
+// Quantized position moved by delta units, back in pixels
+static Sint16 MovePosition(Sint16 base, int delta)
+{
+	return (Sint16)((Quantize(base) + delta)*SPECTATE_QUANTUM);
+}
+
+static void ViewFromSim(const SimState* sim, SpectatorView* view)
+{
+	view->tick = sim->tick;
+	view->alive = sim->alive;
+	for (int p = 0; p < MAX_PLAYERS; ++p) view->ship_x[p] = sim->ship_x[p];
+	view->ship_y = sim->ship_y;
+	view->scroll = sim->scroll;
+	view->screen = sim->screen;
+	view->players = sim->players;
+	view->ships_alive = sim->ships_alive;
+	SDL_memcpy(view->shot_x, sim->shot_x, sizeof(view->shot_x));
+	SDL_memcpy(view->shot_y, sim->shot_y, sizeof(view->shot_y));
+}
+
+// Only the fields drawing reads are set
+static void SimFromView(const SpectatorView* view, SimState* sim)
+{
+	SDL_zerop(sim);
+
+	sim->tick = view->tick;
+	sim->alive = view->alive;
+	for (int p = 0; p < MAX_PLAYERS; ++p) sim->ship_x[p] = view->ship_x[p];
+	sim->ship_y = view->ship_y;
+	sim->scroll = view->scroll;
+	sim->screen = view->screen;
+	sim->players = view->players;
+	sim->ships_alive = view->ships_alive;
+	SDL_memcpy(sim->shot_x, view->shot_x, sizeof(sim->shot_x));
+	SDL_memcpy(sim->shot_y, view->shot_y, sizeof(sim->shot_y));
+}
+
+static void DropSpectator(int index)
+{
+	CloseStream(spectators[index]->stream);
+	SDL_free(spectators[index]);
+	spectators[index] = NULL;
+	stats.spectators--;
+}
+
+static void QueueBytes(int index, const Uint8* data, int size)
+{
+	Spectator* spectator = spectators[index];
+
+	// A message can't be skipped, the next ones go against it
+	if (spectator->pending + size > SPECTATOR_BUFFER)
+	{
+		printf("WARNING: Spectator %i can't keep up with the broadcast, dropped\n", index);
+		stats.dropped++;
+		DropSpectator(index);
+		return;
+	}
+
+	SDL_memcpy(&spectator->buffer[spectator->pending], data, size);
+	spectator->pending += size;
+}
+
+static void FlushSpectator(int index)
+{
+	Spectator* spectator = spectators[index];
+	if (spectator->pending == 0) return;
+
+	int sent = SendStream(spectator->stream, spectator->buffer, spectator->pending);
+
+	if (sent < 0)
+	{
+		DropSpectator(index);
+		return;
+	}
+
+	spectator->pending -= sent;
+	SDL_memmove(spectator->buffer, &spectator->buffer[sent], spectator->pending);
+}
+
+static void AcceptSpectators()
+{
+	NetStream stream;
+
+	while ((stream = AcceptStream(listener)) != NET_NO_STREAM)
+	{
+		int index = 0;
+		while ((index < MAX_SPECTATORS) && (spectators[index] != NULL)) index++;
+
+		if (index == MAX_SPECTATORS)
+		{
+			CloseStream(stream);
+			continue;
+		}
+
+		spectators[index] = (Spectator*)SDL_malloc(sizeof(Spectator));
+
+		if (spectators[index] == NULL)
+		{
+			printf("WARNING: Cannot allocate spectator %i, dropped\n", index);
+			CloseStream(stream);
+			stats.dropped++;
+			continue;
+		}
+
+		spectators[index]->stream = stream;
+		spectators[index]->pending = 0;
+		stats.spectators++;
+		if (stats.spectators > stats.peak_spectators) stats.peak_spectators = stats.spectators;
+
+		Uint8 header[STREAM_HEADER_SIZE];
+		Uint32 magic = SDL_SwapLE32(SPECTATE_MAGIC);
+		Uint16 version = SDL_SwapLE16(SIM_STATE_VERSION);
+		SDL_memcpy(&header[0], &magic, 4);
+		SDL_memcpy(&header[4], &version, 2);
+
+		// Everything later goes against the view they start from
+		Uint8 keyframe[MAX_VIEW_MESSAGE];
+		int size = EncodeViewMessage(&view, &empty, true, keyframe);
+
+		QueueBytes(index, header, STREAM_HEADER_SIZE);
+		QueueBytes(index, keyframe, size);
+		stats.keyframes++;
+	}
+}
+
+static bool OpenWatcher(Watcher* watcher, const char* host, int port)
+{
+	watcher->source = ConnectStream(host, port);
+	watcher->received_size = 0;
+	watcher->decoded = 0;
+	watcher->header_read = false;
+	watcher->has_keyframe = false;
+	SDL_zero(watcher->stats);
+
+	return (watcher->source != NET_NO_STREAM);
+}
+
+static void CloseWatcher(Watcher* watcher)
+{
+	CloseStream(watcher->source);
+	watcher->source = NET_NO_STREAM;
+}
+
+// Read everything the socket has, returns false once the broadcast ended
+static bool ReceiveWatcher(Watcher* watcher)
+{
+	// Make room, decoded messages are not needed anymore
+	watcher->received_size -= watcher->decoded;
+	SDL_memmove(watcher->received, &watcher->received[watcher->decoded], watcher->received_size);
+	watcher->decoded = 0;
+
+	while (watcher->received_size < SPECTATOR_BUFFER)
+	{
+		int size = ReceiveStream(watcher->source, &watcher->received[watcher->received_size], SPECTATOR_BUFFER - watcher->received_size);
+
+		if (size < 0) return false;
+		if (size == 0) break;
+
+		watcher->received_size += size;
+		watcher->stats.bytes += size;
+	}
+
+	return true;
+}
+
+// Next complete message into the watcher view
+// Returns 1 if one was decoded, 0 if it did not arrive yet, -1 if the stream is not a valid one
+static int DecodeWatcher(Watcher* watcher)
+{
+	const Uint8* data = &watcher->received[watcher->decoded];
+	int size = watcher->received_size - watcher->decoded;
+
+	if (!watcher->header_read)
+	{
+		if (size < STREAM_HEADER_SIZE) return 0;
+
+		Uint32 magic;
+		Uint16 version;
+		SDL_memcpy(&magic, &data[0], 4);
+		SDL_memcpy(&version, &data[4], 2);
+
+		if ((SDL_SwapLE32(magic) != SPECTATE_MAGIC) || (SDL_SwapLE16(version) != SIM_STATE_VERSION))
+		{
+			printf("WARNING: Broadcast is not a version %i game stream\n", SIM_STATE_VERSION);
+			return -1;
+		}
+
+		watcher->header_read = true;
+		watcher->decoded += STREAM_HEADER_SIZE;
+		data += STREAM_HEADER_SIZE;
+		size -= STREAM_HEADER_SIZE;
+	}
+
+	if (size < 1) return 0;
+
+	bool keyframe = (data[0] & VIEW_KEYFRAME) != 0;
+	SpectatorView base;
+
+	if (keyframe) base = empty;
+	else if (watcher->has_keyframe) PredictView(&watcher->view, &base);
+	else return -1;
+
+	int used = DecodeViewMessage(data, size, &base, &watcher->view);
+
+	if (used < 0) printf("WARNING: Broadcast stream is corrupted\n");
+	if (used <= 0) return used;
+
+	watcher->decoded += used;
+	if (keyframe) watcher->stats.keyframes++;
+	else watcher->stats.ticks++;
+	watcher->has_keyframe |= keyframe;
+
+	return 1;
+}
+
+// What spectators end up with: positions rounded down to SPECTATE_QUANTUM pixels
+static void QuantizeView(const SpectatorView* view, SpectatorView* quantized)
+{
+	*quantized = *view;
+
+	for (int p = 0; p < MAX_PLAYERS; ++p) quantized->ship_x[p] = (Sint16)(Quantize(view->ship_x[p])*SPECTATE_QUANTUM);
+	quantized->ship_y = (Sint16)(Quantize(view->ship_y)*SPECTATE_QUANTUM);
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		quantized->shot_x[i] = (Sint16)(Quantize(view->shot_x[i])*SPECTATE_QUANTUM);
+		quantized->shot_y[i] = (Sint16)(Quantize(view->shot_y[i])*SPECTATE_QUANTUM);
+	}
+}
+
+// Dead asteroids are not drawn nor sent, their positions are left out
+static bool SameView(const SpectatorView* view, const SpectatorView* expected)
+{
+	bool same = (view->tick == expected->tick) && (view->alive == expected->alive) && (view->ship_y == expected->ship_y) &&
+		(view->scroll == expected->scroll) && (view->screen == expected->screen) && (view->players == expected->players) &&
+		(view->ships_alive == expected->ships_alive);
+
+	for (int p = 0; p < MAX_PLAYERS; ++p) same &= (view->ship_x[p] == expected->ship_x[p]);
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if (expected->alive & (1u << i)) same &= (view->shot_x[i] == expected->shot_x[i]) && (view->shot_y[i] == expected->shot_y[i]);
+	}
+
+	return same;
+}
+
+// Compare every view the watcher decodes with the game one of its tick
+// Returns false at the first one differing, the watcher is closed
+static bool CheckWatcher(Watcher* watcher, int index, const SpectatorView* expected, Uint32 first, Uint32 tick, Uint32* last_tick, int* views)
+{
+	if (watcher->source == NET_NO_STREAM) return true;
+
+	bool open = ReceiveWatcher(watcher);
+	int result = 0;
+
+	while ((result = DecodeWatcher(watcher)) > 0)
+	{
+		Uint32 seen = watcher->view.tick;
+		bool known = (seen >= first) && (seen <= tick);
+
+		// After the keyframe every tick comes, once and in order
+		if (!known || ((*views > 0) && (seen != *last_tick + 1)) || !SameView(&watcher->view, &expected[known? seen - first : 0]))
+		{
+			printf("Spectate check: spectator %i view of tick %u differs from the game\n", index, seen);
+			CloseWatcher(watcher);
+			return false;
+		}
+
+		*last_tick = seen;
+		(*views)++;
+	}
+
+	if ((result < 0) || !open)
+	{
+		if (result == 0) printf("Spectate check: spectator %i lost the broadcast at tick %u\n", index, *last_tick);
+		CloseWatcher(watcher);
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+int EncodeViewMessage(const SpectatorView* view, const SpectatorView* base, bool keyframe, Uint8* out)
+{
+	Uint8 mask = keyframe? VIEW_KEYFRAME : 0;
+	int size = 1;
+
+	if (view->tick != base->tick)
+	{
+		mask |= VIEW_TICK;
+		size += PutVarint(&out[size], view->tick - base->tick);
+	}
+
+	if (view->screen != base->screen)
+	{
+		mask |= VIEW_SCREEN;
+		out[size++] = view->screen;
+	}
+
+	if ((view->players != base->players) || (view->ships_alive != base->ships_alive) || (Quantize(view->ship_y) != Quantize(base->ship_y)))
+	{
+		mask |= VIEW_PLAYERS;
+		out[size++] = view->players;
+		out[size++] = view->ships_alive;
+		size += PutVarint(&out[size], ZigZag(Quantize(view->ship_y) - Quantize(base->ship_y)));
+	}
+
+	bool ships_moved = false;
+	for (int p = 0; p < MAX_PLAYERS; ++p) ships_moved |= (Quantize(view->ship_x[p]) != Quantize(base->ship_x[p]));
+
+	if (ships_moved)
+	{
+		mask |= VIEW_SHIPS;
+		for (int p = 0; p < MAX_PLAYERS; ++p) size += PutVarint(&out[size], ZigZag(Quantize(view->ship_x[p]) - Quantize(base->ship_x[p])));
+	}
+
+	// Scroll is predicted exactly, it is sent in pixels
+	if (view->scroll != base->scroll)
+	{
+		mask |= VIEW_SCROLL;
+		size += PutVarint(&out[size], ZigZag(view->scroll - base->scroll));
+	}
+
+	if (view->alive != base->alive)
+	{
+		mask |= VIEW_ALIVE;
+		size += PutVarint(&out[size], view->alive ^ base->alive);
+	}
+
+	// Dead asteroids are not drawn, their positions don't matter
+	Uint8 moved[MAX_SHIP_SHOTS];
+	int moved_count = 0;
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((view->alive & (1u << i)) == 0) continue;
+
+		if ((Quantize(view->shot_x[i]) != Quantize(base->shot_x[i])) || (Quantize(view->shot_y[i]) != Quantize(base->shot_y[i]))) moved[moved_count++] = (Uint8)i;
+	}
+
+	if (moved_count > 0)
+	{
+		mask |= VIEW_SHOTS;
+		out[size++] = (Uint8)moved_count;
+
+		for (int k = 0; k < moved_count; ++k)
+		{
+			int i = moved[k];
+			out[size++] = (Uint8)i;
+			size += PutVarint(&out[size], ZigZag(Quantize(view->shot_x[i]) - Quantize(base->shot_x[i])));
+			size += PutVarint(&out[size], ZigZag(Quantize(view->shot_y[i]) - Quantize(base->shot_y[i])));
+		}
+	}
+
+	out[0] = mask;
+
+	return size;
+}
+
+// ----------------------------------------------------------------
+int DecodeViewMessage(const Uint8* data, int size, const SpectatorView* base, SpectatorView* view)
+{
+	if (size < 1) return 0;
+
+	SpectatorView next = *base;
+	Uint8 mask = data[0];
+	int offset = 1;
+	Uint32 raw = 0;
+	int value = 0;
+
+	// NOTE: Running out of data only means the rest of the message did not arrive yet
+	if (mask & VIEW_TICK)
+	{
+		if (!GetVarint(data, size, &offset, &raw)) return 0;
+		next.tick = base->tick + raw;
+	}
+
+	if (mask & VIEW_SCREEN)
+	{
+		if (offset + 1 > size) return 0;
+		next.screen = data[offset++];
+		if (next.screen >= SCREEN_COUNT) return -1;
+	}
+
+	if (mask & VIEW_PLAYERS)
+	{
+		if (offset + 2 > size) return 0;
+		next.players = data[offset++];
+		next.ships_alive = data[offset++];
+		if (!GetSigned(data, size, &offset, &value)) return 0;
+		next.ship_y = MovePosition(base->ship_y, value);
+		if ((next.players < 1) || (next.players > MAX_PLAYERS)) return -1;
+	}
+
+	if (mask & VIEW_SHIPS)
+	{
+		for (int p = 0; p < MAX_PLAYERS; ++p)
+		{
+			if (!GetSigned(data, size, &offset, &value)) return 0;
+			next.ship_x[p] = MovePosition(base->ship_x[p], value);
+		}
+	}
+
+	if (mask & VIEW_SCROLL)
+	{
+		if (!GetSigned(data, size, &offset, &value)) return 0;
+		next.scroll = (Sint16)(base->scroll + value);
+	}
+
+	if (mask & VIEW_ALIVE)
+	{
+		if (!GetVarint(data, size, &offset, &raw)) return 0;
+		next.alive = base->alive ^ raw;
+	}
+
+	if (mask & VIEW_SHOTS)
+	{
+		if (offset + 1 > size) return 0;
+		int count = data[offset++];
+
+		for (int k = 0; k < count; ++k)
+		{
+			if (offset + 1 > size) return 0;
+			int i = data[offset++];
+			if (i >= MAX_SHIP_SHOTS) return -1;
+
+			if (!GetSigned(data, size, &offset, &value)) return 0;
+			next.shot_x[i] = MovePosition(base->shot_x[i], value);
+			if (!GetSigned(data, size, &offset, &value)) return 0;
+			next.shot_y[i] = MovePosition(base->shot_y[i], value);
+		}
+	}
+
+	*view = next;
+
+	return offset;
+}
+
+// ----------------------------------------------------------------
+void PredictView(const SpectatorView* view, SpectatorView* predicted)
+{
+	*predicted = *view;
+	predicted->tick++;
+
+	// NOTE: Mirrors the gameplay motion, anything it misses only costs bytes
+	if (view->screen != GAMEPLAY) return;
+
+	predicted->scroll -= SCROLL_SPEED;
+	if (predicted->scroll <= 0) predicted->scroll = BACKGROUND_HEIGHT;
+
+	for (int i = 0; i < MAX_SHIP_SHOTS; ++i)
+	{
+		if ((view->alive & (1u << i)) && (view->shot_y[i] < SCREEN_HEIGHT)) predicted->shot_y[i] += SHOT_SPEED;
+	}
+}
+
+// ----------------------------------------------------------------
+bool StartBroadcast(int port)
+{
+	listener = ListenStream(port);
+	if (listener == NET_NO_STREAM) return false;
+
+	has_view = false;
+	SDL_zero(stats);
+
+	printf("Broadcasting on TCP port %i\n", port);
+
+	return true;
+}
+
+// ----------------------------------------------------------------
+void BroadcastTick(const SimState* sim)
+{
+	if (listener == NET_NO_STREAM) return;
+
+	Uint8 message[MAX_VIEW_MESSAGE];
+	int size = 0;
+	SpectatorView actual;
+	ViewFromSim(sim, &actual);
+
+	// Spectators decode exactly the same, the view follows the quantized positions they have
+	if (has_view)
+	{
+		SpectatorView predicted;
+		PredictView(&view, &predicted);
+		size = EncodeViewMessage(&actual, &predicted, false, message);
+		DecodeViewMessage(message, size, &predicted, &view);
+
+		stats.ticks++;
+		stats.bytes += size;
+	}
+	else
+	{
+		size = EncodeViewMessage(&actual, &empty, true, message);
+		DecodeViewMessage(message, size, &empty, &view);
+		has_view = true;
+		size = 0;
+	}
+
+	for (int i = 0; i < MAX_SPECTATORS; ++i) if ((spectators[i] != NULL) && (size > 0)) QueueBytes(i, message, size);
+
+	AcceptSpectators();
+
+	for (int i = 0; i < MAX_SPECTATORS; ++i) if (spectators[i] != NULL) FlushSpectator(i);
+}
+
+// ----------------------------------------------------------------
+void StopBroadcast()
+{
+	for (int i = 0; i < MAX_SPECTATORS; ++i) if (spectators[i] != NULL) DropSpectator(i);
+
+	CloseStream(listener);
+	listener = NET_NO_STREAM;
+}
+
+// ----------------------------------------------------------------
+BroadcastStats GetBroadcastStats()
+{
+	BroadcastStats result = stats;
+	result.bytes_per_second = (stats.ticks > 0)? (float)stats.bytes*SIM_TICK_RATE/stats.ticks : 0.0f;
+
+	return result;
+}
+
+// ----------------------------------------------------------------
+bool StartSpectating(const char* host, int port)
+{
+	return OpenWatcher(&watching, host, port);
+}
+
+// ----------------------------------------------------------------
+bool UpdateSpectating(SimState* sim)
+{
+	if (watching.source == NET_NO_STREAM) return false;
+
+	bool open = ReceiveWatcher(&watching);
+	int result = 0;
+
+	while ((result = DecodeWatcher(&watching)) > 0) {}
+	if (result < 0) open = false;
+
+	if (watching.has_keyframe) SimFromView(&watching.view, sim);
+
+	if (!open) CloseWatcher(&watching);
+
+	return open;
+}
+
+// ----------------------------------------------------------------
+void StopSpectating()
+{
+	CloseWatcher(&watching);
+}
+
+// ----------------------------------------------------------------
+BroadcastStats GetSpectatingStats()
+{
+	BroadcastStats result = watching.stats;
+	result.bytes_per_second = (watching.stats.ticks > 0)? (float)watching.stats.bytes*SIM_TICK_RATE/watching.stats.ticks : 0.0f;
+
+	return result;
+}
+
+// ----------------------------------------------------------------
+bool CheckBroadcast(int port, Uint32 seed, int players)
+{
+	if (!StartBroadcast(port)) return false;
+
+	Watcher* watchers = (Watcher*)SDL_calloc(CHECK_SPECTATORS, sizeof(Watcher));
+	SpectatorView* expected = (SpectatorView*)SDL_calloc(CHECK_TICKS, sizeof(SpectatorView));
+	Uint32 last_tick[CHECK_SPECTATORS] = { 0 };
+	int views[CHECK_SPECTATORS] = { 0 };
+	bool same = true;
+
+	if ((watchers == NULL) || (expected == NULL))
+	{
+		printf("WARNING: Cannot allocate the spectate check views\n");
+		SDL_free(expected);
+		SDL_free(watchers);
+		StopBroadcast();
+		return false;
+	}
+
+	for (int w = 0; w < CHECK_SPECTATORS; ++w) watchers[w].source = NET_NO_STREAM;
+
+	SimState sim;
+	InitSim(&sim, seed, players);
+	Uint32 first = sim.tick + 1;
+
+	// Novices lose often, the stream goes through every screen
+	Bot bots[MAX_PLAYERS];
+	for (int p = 0; p < players; ++p) ResetBot(&bots[p], p, BOT_NOVICE, seed + p);
+
+	bool connected = OpenWatcher(&watchers[0], "127.0.0.1", port);
+
+	for (int t = 0; connected && (t < CHECK_TICKS); ++t)
+	{
+		if (t == CHECK_TICKS/2) connected = OpenWatcher(&watchers[1], "127.0.0.1", port);
+
+		Uint32 actions = 0;
+		for (int p = 0; p < players; ++p) actions |= StepBot(&bots[p], &sim) << (p*PLAYER_ACTION_BITS);
+
+		MoveStuff(&sim, actions, NULL);
+
+		SpectatorView actual;
+		ViewFromSim(&sim, &actual);
+		QuantizeView(&actual, &expected[t]);
+
+		BroadcastTick(&sim);
+
+		for (int w = 0; w < CHECK_SPECTATORS; ++w) same &= CheckWatcher(&watchers[w], w, expected, first, sim.tick, &last_tick[w], &views[w]);
+	}
+
+	// Loopback is fast but not instant, the last messages may still be on their way
+	Uint32 deadline = SDL_GetTicks() + CHECK_DRAIN_MS;
+	bool behind = connected;
+
+	while (behind && (SDL_GetTicks() < deadline))
+	{
+		SDL_Delay(1);
+		behind = false;
+
+		for (int w = 0; w < CHECK_SPECTATORS; ++w)
+		{
+			same &= CheckWatcher(&watchers[w], w, expected, first, sim.tick, &last_tick[w], &views[w]);
+			behind |= (watchers[w].source != NET_NO_STREAM) && (last_tick[w] != sim.tick);
+		}
+	}
+
+	if (!connected)
+	{
+		printf("Spectate check: unable to watch the broadcast on 127.0.0.1:%i\n", port);
+		same = false;
+	}
+
+	int total_views = 0;
+
+	for (int w = 0; w < CHECK_SPECTATORS; ++w)
+	{
+		if ((watchers[w].source != NET_NO_STREAM) && (last_tick[w] != sim.tick))
+		{
+			printf("Spectate check: spectator %i stopped at tick %u, the broadcast ended at %u\n", w, last_tick[w], sim.tick);
+			same = false;
+		}
+
+		total_views += views[w];
+	}
+
+	BroadcastStats broadcast_stats = GetBroadcastStats();
+
+	if (same) printf("Spectate check: %i views of %i spectators match the game, %i ticks, %.0f bytes/s, seed %u\n", total_views, CHECK_SPECTATORS, broadcast_stats.ticks, broadcast_stats.bytes_per_second, seed);
+	else printf("Spectate check: the broadcast diverges, seed %u\n", seed);
+
+	for (int w = 0; w < CHECK_SPECTATORS; ++w) CloseWatcher(&watchers[w]);
+	StopBroadcast();
+
+	SDL_free(expected);
+	SDL_free(watchers);
+
+	return same;
+}
@@ -0,0 +1,91 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// Spectate - Live game broadcast to spectators over TCP
+//
+// Spectators only get what drawing needs (SpectatorView), one message per
+// tick. Both ends predict the next view with the same motion model
+// (asteroids fall, background scrolls) and a message only carries what
+// the prediction missed: ship moves, waves spawned, screen changes...
+// Positions travel in SPECTATE_QUANTUM pixel units, differences as zigzag
+// varints, so a gameplay tick is a few bytes and an idle one a single
+// byte. Spectators joining late get a keyframe, the whole view, first.
+//
+// Stream layout: header (magic "SPEC", SimState version), then messages:
+//   [mask][fields in mask bits order]
+//   mask bit 7 set: keyframe, fields are against an empty view
+// -------------------------------------------------------------------------
+
+#ifndef __SPECTATE_H__
+#define __SPECTATE_H__
+
+#include "SDL/include/SDL.h"		// Required for SDL base systems functionality
+
+#include "Game.h"
+
+#define MAX_SPECTATORS			  32
+#define SPECTATE_QUANTUM		   2		// Pixels per position unit sent
+#define MAX_VIEW_MESSAGE		 512
+#define SPECTATOR_BUFFER	 (16*1024)		// Bytes queued per spectator, slower ones are dropped
+
+// SimState fields drawing reads
+struct SpectatorView
+{
+	Uint32 tick;
+	Uint32 alive;
+	Sint16 ship_x[MAX_PLAYERS];
+	Sint16 ship_y;
+	Sint16 scroll;
+	Uint8 screen;
+	Uint8 players;
+	Uint8 ships_alive;
+	Sint16 shot_x[MAX_SHIP_SHOTS];
+	Sint16 shot_y[MAX_SHIP_SHOTS];
+};
+
+struct BroadcastStats
+{
+	int ticks;
+	int keyframes;
+	int spectators;				// Connected now
+	int peak_spectators;
+	int dropped;				// Too slow to keep up
+	Uint64 bytes;				// Stream bytes a spectator watching every tick got
+	float bytes_per_second;
+};
+
+// Encode view as a message against base: the view predicted from the last one, or an empty view for keyframes
+int EncodeViewMessage(const SpectatorView* view, const SpectatorView* base, bool keyframe, Uint8* out);
+
+// Decode the message at data against base, returns bytes used, 0 if incomplete, -1 if malformed
+int DecodeViewMessage(const Uint8* data, int size, const SpectatorView* base, SpectatorView* view);
+
+// Next tick view as the motion model sees it
+void PredictView(const SpectatorView* view, SpectatorView* predicted);
+
+// Accept spectators on a TCP port, any interface
+bool StartBroadcast(int port);
+
+// Send the tick to every spectator, accepting new ones, call it after every simulation tick
+void BroadcastTick(const SimState* sim);
+
+void StopBroadcast();
+BroadcastStats GetBroadcastStats();
+
+// Spectator mode, the game is drawn from the stream of host:port
+bool StartSpectating(const char* host, int port);
+
+// Read every message received, sim gets the latest view for drawing
+// Returns false once the broadcast ended
+bool UpdateSpectating(SimState* sim);
+
+void StopSpectating();
+
+// Ticks, keyframes and bytes received, spectators fields unused
+BroadcastStats GetSpectatingStats();
+
+// Broadcast bot games on port and watch them on 127.0.0.1 in the same process, one spectator from
+// the start and one joining halfway: every view decoded must be the game one, positions quantized
+// Returns false at the first view differing or missing
+bool CheckBroadcast(int port, Uint32 seed, int players);
+
+#endif // __SPECTATE_H__
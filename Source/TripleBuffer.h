@@ -0,0 +1,56 @@
+// -------------------------------------------------------------------------
+// Awesome simple game with SDL
+// TripleBuffer - Lock-free latest value exchange between two threads
+//
+// One thread may only write and publish, one other thread may only read.
+// The writer never waits for the reader and the reader always gets the
+// most recent complete value: three slots, one owned by each side and a
+// middle one swapped with an atomic exchange.
+// -------------------------------------------------------------------------
+
+#ifndef __TRIPLEBUFFER_H__
+#define __TRIPLEBUFFER_H__
+
+#include "SDL/include/SDL.h"		// Required for: SDL_atomic_t, SDL_CACHELINE_SIZE
+
+#define TRIPLE_BUFFER_FRESH		4	// Middle slot flag: published but not read yet
+
+template <typename T>
+struct TripleBuffer
+{
+	T slots[3];
+	SDL_atomic_t middle;			// Slot index exchanged between both sides, plus TRIPLE_BUFFER_FRESH
+	char pad0[SDL_CACHELINE_SIZE - sizeof(SDL_atomic_t)];
+	int back;						// Slot being written, writer only
+	char pad1[SDL_CACHELINE_SIZE - sizeof(int)];
+	int front;						// Slot being read, reader only
+
+	void Clear()
+	{
+		back = 0;
+		front = 1;
+		SDL_AtomicSet(&middle, 2);
+	}
+
+	// Writer side: fill the returned slot, then Publish() it
+	T* Write()
+	{
+		return &slots[back];
+	}
+
+	void Publish()
+	{
+		back = SDL_AtomicSet(&middle, back | TRIPLE_BUFFER_FRESH) & 3;
+	}
+
+	// Reader side: latest published value, the same as last call if nothing new
+	// NOTE: Value stays valid and unchanged until next Read()
+	const T* Read()
+	{
+		if (SDL_AtomicGet(&middle) & TRIPLE_BUFFER_FRESH) front = SDL_AtomicSet(&middle, front) & 3;
+
+		return &slots[front];
+	}
+};
+
+#endif // __TRIPLEBUFFER_H__